@@ -0,0 +1,38 @@
+#include "Arena.hpp"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+
+Arena::~Arena() {
+    for (auto it = m_Dtors.rbegin(); it != m_Dtors.rend(); ++it)
+        it->second(it->first);
+    for (auto b : m_Blocks)
+        ::operator delete(b);
+}
+
+void *Arena::Allocate(size_t size, size_t align) {
+    uintptr_t p = ((uintptr_t) m_Cur + align - 1) & ~(uintptr_t) (align - 1);
+    if (!m_Cur || p + size > (uintptr_t) m_End) {
+        // oversized requests get a block of their own
+        size_t len = size + align > BlockSize ? size + align : BlockSize;
+        char *b = (char *) ::operator new(len, std::nothrow);  // counted by --mem-report
+        if (!b) {
+            printf("Out of memory.\n");
+            exit(1);
+        }
+        m_Blocks.push_back(b);
+        m_Reserved += len;
+        m_Cur = b;
+        m_End = b + len;
+        p = ((uintptr_t) m_Cur + align - 1) & ~(uintptr_t) (align - 1);
+    }
+    m_Cur = (char *) (p + size);
+    m_Allocated += size;
+    ++m_Objects;
+    return (void *) p;
+}
+
+void Arena::AddDestructor(void *p, void (*dtor)(void *)) {
+    m_Dtors.emplace_back(p, dtor);
+}
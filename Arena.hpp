@@ -0,0 +1,63 @@
+#ifndef PJPPROJECT_ARENA_HPP
+#define PJPPROJECT_ARENA_HPP
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <typeinfo>
+#include <utility>
+#include <vector>
+
+/*
+ * Bump allocator for objects that all die together (the AST of one compilation).
+ * Memory is carved out of large blocks and only returned when the arena is destroyed.
+ * Objects that need a destructor run register it; destructors run in reverse order
+ * of allocation, each one only cleaning up its own members.
+ */
+class Arena {
+public:
+    Arena() = default;
+    ~Arena();
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    // told about every object made by Make(), for --mem-report
+    class Observer {
+    public:
+        virtual ~Observer() = default;
+        virtual void Made(const std::type_info &type, size_t size) = 0;
+    };
+    void SetObserver(Observer *observer) { m_Observer = observer; }
+
+    void *Allocate(size_t size, size_t align = alignof(std::max_align_t));
+    // calls dtor(p) when the arena is released
+    void AddDestructor(void *p, void (*dtor)(void *));
+
+    template<class T, class... Args>
+    T *Make(Args&&... args) {
+        T *p = new (Allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+        if (!std::is_trivially_destructible<T>::value)
+            AddDestructor(p, [](void *q) { static_cast<T *>(q)->~T(); });
+        if (m_Observer)
+            m_Observer->Made(typeid(T), sizeof(T));
+        return p;
+    }
+
+    size_t BytesAllocated() const { return m_Allocated; }
+    size_t BlockCount() const { return m_Blocks.size(); }
+    size_t BytesReserved() const { return m_Reserved; }   // the blocks, used or not
+    size_t ObjectCount() const { return m_Objects; }
+private:
+    static const size_t BlockSize = 64 * 1024;
+
+    std::vector<char *> m_Blocks;
+    std::vector<std::pair<void *, void (*)(void *)>> m_Dtors;
+    char *m_Cur = nullptr;
+    char *m_End = nullptr;
+    size_t m_Allocated = 0;
+    size_t m_Reserved = 0;
+    size_t m_Objects = 0;
+    Observer *m_Observer = nullptr;
+};
+
+#endif //PJPPROJECT_ARENA_HPP
@@ -0,0 +1,154 @@
+#include "Backend.hpp"
+
+#include <cstdio>
+
+#include <llvm/IR/LegacyPassManager.h>
+#include <llvm/IRReader/IRReader.h>
+#include <llvm/Linker/Linker.h>
+#include <llvm/Support/SourceMgr.h>
+#include <llvm/Transforms/IPO/Internalize.h>
+#include <llvm/MC/MCSubtargetInfo.h>
+#include <llvm/MC/SubtargetFeature.h>
+#include <llvm/MC/TargetRegistry.h>
+#include <llvm/Support/Host.h>
+#include <llvm/Support/Program.h>
+#include <llvm/Support/TargetSelect.h>
+#include <llvm/Support/TimeProfiler.h>
+
+void InitializeBackend() {
+    llvm::InitializeNativeTarget();
+    llvm::InitializeNativeTargetAsmPrinter();
+    llvm::InitializeNativeTargetAsmParser();
+}
+
+static const llvm::Target *HostTarget(const std::string &triple) {
+    std::string error;
+    const llvm::Target *target = llvm::TargetRegistry::lookupTarget(triple, error);
+    if (!target) {
+        printf("Cannot create target %s: %s\n", triple.c_str(), error.c_str());
+        exit(1);
+    }
+    return target;
+}
+
+bool ResolveCPU(const std::string &cpu, std::string &name, std::string &features) {
+    features.clear();
+    if (cpu != "native") {
+        name = cpu;
+        std::string triple = llvm::sys::getDefaultTargetTriple();
+        std::unique_ptr<llvm::MCSubtargetInfo> info(HostTarget(triple)->createMCSubtargetInfo(triple, "", ""));
+        return info && info->isCPUStringValid(name);
+    }
+    name = llvm::sys::getHostCPUName().str();
+    llvm::StringMap<bool> host;
+    if (llvm::sys::getHostCPUFeatures(host)) {
+        llvm::SubtargetFeatures list;
+        for (auto &f : host)
+            list.AddFeature(f.first(), f.second);
+        features = list.getString();
+    }
+    return true;
+}
+
+std::unique_ptr<llvm::TargetMachine> CreateTargetMachine(llvm::OptimizationLevel level, const std::string &cpu) {
+    std::string triple = llvm::sys::getDefaultTargetTriple();
+    const llvm::Target *target = HostTarget(triple);
+    std::string name, features;
+    ResolveCPU(cpu, name, features);
+    llvm::CodeGenOpt::Level cg = llvm::CodeGenOpt::None;
+    if (level.getSpeedupLevel() == 1)
+        cg = llvm::CodeGenOpt::Less;
+    else if (level.getSpeedupLevel() == 2)
+        cg = llvm::CodeGenOpt::Default;
+    else if (level.getSpeedupLevel() >= 3)
+        cg = llvm::CodeGenOpt::Aggressive;
+
+    llvm::TargetOptions options;
+    return std::unique_ptr<llvm::TargetMachine>(target->createTargetMachine(
+            triple, name, features, options, llvm::Reloc::PIC_, llvm::None, cg));
+}
+
+void ConfigureModule(llvm::Module &module, llvm::TargetMachine &tm) {
+    module.setTargetTriple(tm.getTargetTriple().str());
+    module.setDataLayout(tm.createDataLayout());
+}
+
+bool LinkRuntime(llvm::Module &module, const std::string &bitcode) {
+    llvm::SMDiagnostic diag;
+    std::unique_ptr<llvm::Module> runtime = llvm::parseIRFile(bitcode, diag, module.getContext());
+    if (!runtime) {
+        printf("Cannot read runtime %s: %s\n", bitcode.c_str(), diag.getMessage().str().c_str());
+        return false;
+    }
+    runtime->setTargetTriple(module.getTargetTriple());
+    runtime->setDataLayout(module.getDataLayout());
+    bool failed = llvm::Linker::linkModules(module, std::move(runtime), llvm::Linker::LinkOnlyNeeded,
+            [](llvm::Module &m, const llvm::StringSet<> &linked) {
+                llvm::internalizeModule(m, [&](const llvm::GlobalValue &gv) {
+                    return !gv.hasName() || !linked.count(gv.getName());
+                });
+            });
+    if (failed) {
+        printf("Cannot link runtime %s.\n", bitcode.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool EmitCode(llvm::Module &module, llvm::TargetMachine &tm, llvm::CodeGenFileType type, llvm::raw_pwrite_stream &out) {
+    llvm::TimeTraceScope trace("Emit");
+    llvm::legacy::PassManager PM;
+    if (tm.addPassesToEmitFile(PM, out, nullptr, type)) {
+        printf("Target cannot emit this file type.\n");
+        return false;
+    }
+    PM.run(module);
+    out.flush();
+    return true;
+}
+
+bool LinkRelocatable(const std::vector<std::string> &objects, const std::string &linker, const std::string &output) {
+    auto program = llvm::sys::findProgramByName(linker);
+    if (!program) {
+        printf("Cannot find linker %s.\n", linker.c_str());
+        return false;
+    }
+    std::vector<llvm::StringRef> args = {*program, "-r", "-nostdlib"};
+    for (auto &o : objects)
+        args.push_back(o);
+    args.push_back("-o");
+    args.push_back(output);
+
+    std::string error;
+    int rc = llvm::sys::ExecuteAndWait(*program, args, llvm::None, {}, 0, 0, &error);
+    if (rc != 0) {
+        printf("Linking %s failed%s%s.\n", output.c_str(), error.empty() ? "" : ": ", error.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool LinkExecutable(const std::vector<std::string> &objects, const std::string &runtime,
+                    const std::string &linker, bool staticLink, const std::string &output) {
+    auto program = llvm::sys::findProgramByName(linker);
+    if (!program) {
+        printf("Cannot find linker %s.\n", linker.c_str());
+        return false;
+    }
+    std::vector<llvm::StringRef> args = {*program};
+    for (auto &o : objects)
+        args.push_back(o);
+    args.push_back(runtime);
+    if (staticLink)
+        args.push_back("-static");
+    args.push_back("-o");
+    args.push_back(output);
+
+    std::string error;
+    int rc = llvm::sys::ExecuteAndWait(*program, args, llvm::None, {}, 0, 0, &error);
+    if (rc != 0) {
+        printf("Linking %s failed%s%s.\n", output.c_str(), error.empty() ? "" : ": ", error.c_str());
+        return false;
+    }
+    return true;
+}
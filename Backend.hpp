@@ -0,0 +1,50 @@
+#ifndef PJPPROJECT_BACKEND_HPP
+#define PJPPROJECT_BACKEND_HPP
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <llvm/IR/Module.h>
+#include <llvm/Passes/OptimizationLevel.h>
+#include <llvm/Support/raw_ostream.h>
+#include <llvm/Target/TargetMachine.h>
+
+// registers the host target, call once before creating target machines
+void InitializeBackend();
+
+/*
+ * CPU name and feature string for -mcpu: "native" is the host's CPU with the
+ * features it has (AVX2, ...), anything else an LLVM CPU name such as "generic"
+ * with that CPU's default features. Returns false for a CPU the target does not know.
+ */
+bool ResolveCPU(const std::string &cpu, std::string &name, std::string &features);
+
+// target machine for the host triple and cpu (see ResolveCPU), tuned for the given optimization level
+std::unique_ptr<llvm::TargetMachine> CreateTargetMachine(llvm::OptimizationLevel level,
+                                                         const std::string &cpu = "native");
+
+// stamps the module with the target triple and data layout of tm
+void ConfigureModule(llvm::Module &module, llvm::TargetMachine &tm);
+
+/*
+ * Merges the runtime compiled to bitcode into module before optimization so its
+ * routines can be inlined. Only what the program uses is linked and it is made
+ * internal, so it cannot clash with libc or with the runtime library.
+ */
+bool LinkRuntime(llvm::Module &module, const std::string &bitcode);
+
+// runs the target code generator, writing an object file or assembly to out
+bool EmitCode(llvm::Module &module, llvm::TargetMachine &tm, llvm::CodeGenFileType type, llvm::raw_pwrite_stream &out);
+
+// combines objects into one relocatable object with the C compiler driver (-r)
+bool LinkRelocatable(const std::vector<std::string> &objects, const std::string &linker, const std::string &output);
+
+/*
+ * Links objects with the Mila runtime into an executable by running the system
+ * C compiler driver once (it knows the crt files and libc of the host).
+ */
+bool LinkExecutable(const std::vector<std::string> &objects, const std::string &runtime,
+                    const std::string &linker, bool staticLink, const std::string &output);
+
+#endif //PJPPROJECT_BACKEND_HPP
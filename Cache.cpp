@@ -0,0 +1,189 @@
+#include "Cache.hpp"
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <tuple>
+#include <vector>
+
+#include <llvm/ADT/SmallString.h>
+#include <llvm/ADT/StringExtras.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/SHA1.h>
+
+namespace {
+
+// holds an exclusive flock on path for its lifetime
+class FileLock {
+public:
+    explicit FileLock(const std::string &path) : m_Fd(open(path.c_str(), O_RDWR | O_CREAT, 0666)) {
+        if (m_Fd >= 0)
+            flock(m_Fd, LOCK_EX);
+    }
+    ~FileLock() {
+        if (m_Fd >= 0)
+            close(m_Fd);  // releases the lock
+    }
+private:
+    int m_Fd;
+};
+
+/*
+ * Copies everything readable from fd to a temporary file next to to and renames it
+ * over to, so readers never see a partial file (and a running executable is
+ * replaced rather than rewritten). The copy gets the permissions of the source.
+ */
+bool CopyTo(int fd, const std::string &to) {
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+        return false;
+    llvm::SmallString<128> tmp;
+    int out;
+    if (llvm::sys::fs::createUniqueFile(to + ".tmp%%%%%%", out, tmp))
+        return false;
+    char buffer[1 << 16];
+    bool ok = true;
+    for (;;) {
+        ssize_t n = read(fd, buffer, sizeof(buffer));
+        if (n <= 0) {
+            ok = n == 0;
+            break;
+        }
+        if (write(out, buffer, n) != n) {
+            ok = false;
+            break;
+        }
+    }
+    ok = ok && fchmod(out, st.st_mode & 0777) == 0;
+    ok = close(out) == 0 && ok;
+    if (ok && !llvm::sys::fs::rename(tmp, to))
+        return true;
+    llvm::sys::fs::remove(tmp);
+    return false;
+}
+
+// entries are named by their key (40 hex digits), anything else in the directory is not one
+bool IsEntry(llvm::StringRef name) {
+    return name.size() == 40 && name.find_first_not_of("0123456789abcdef") == llvm::StringRef::npos;
+}
+
+struct Entry {
+    llvm::sys::TimePoint<> used;
+    uint64_t size;
+    std::string path;
+};
+
+std::vector<Entry> ListEntries(const std::string &dir) {
+    std::vector<Entry> entries;
+    std::error_code ec;
+    for (llvm::sys::fs::directory_iterator it(dir, ec), end; it != end && !ec; it.increment(ec)) {
+        if (!IsEntry(llvm::sys::path::filename(it->path())))
+            continue;
+        llvm::sys::fs::file_status st;
+        if (llvm::sys::fs::status(it->path(), st))
+            continue;
+        entries.push_back({st.getLastModificationTime(), st.getSize(), it->path()});
+    }
+    return entries;
+}
+
+}
+
+CompileCache::CompileCache(std::string dir, uint64_t maxBytes) : m_Dir(std::move(dir)), m_MaxBytes(maxBytes) {
+    llvm::sys::fs::create_directories(m_Dir);
+}
+
+std::string CompileCache::Key(llvm::StringRef source, llvm::StringRef config) {
+    llvm::SHA1 sha;
+    sha.update(config);
+    sha.update(llvm::StringRef("", 1));
+    sha.update(source);
+    return llvm::toHex(sha.final(), true);
+}
+
+std::string CompileCache::EntryPath(const std::string &key) const {
+    llvm::SmallString<128> path(m_Dir);
+    llvm::sys::path::append(path, key);
+    return std::string(path.str());
+}
+
+bool CompileCache::Fetch(const std::string &key, const std::string &output) {
+    // an open entry stays readable even if another process evicts it meanwhile
+    int fd = open(EntryPath(key).c_str(), O_RDONLY);
+    bool hit = fd >= 0 && CopyTo(fd, output);
+    if (fd >= 0) {
+        // the modification time is the last use, eviction goes by it
+        if (hit)
+            llvm::sys::fs::setLastAccessAndModificationTime(fd, std::chrono::system_clock::now());
+        close(fd);
+    }
+    Update(hit, !hit, false);
+    return hit;
+}
+
+void CompileCache::Store(const std::string &key, const std::string &output) {
+    int fd = open(output.c_str(), O_RDONLY);
+    if (fd < 0)
+        return;
+    bool stored = CopyTo(fd, EntryPath(key));
+    close(fd);
+    if (stored)
+        Update(0, 0, true);
+}
+
+void CompileCache::Update(uint64_t hits, uint64_t misses, bool evict) {
+    FileLock lock(EntryPath("lock"));
+    std::string stats = EntryPath("stats");
+    unsigned long long oldHits = 0, oldMisses = 0;
+    if (FILE *f = fopen(stats.c_str(), "r")) {
+        if (fscanf(f, "%llu %llu", &oldHits, &oldMisses) != 2)
+            oldHits = oldMisses = 0;
+        fclose(f);
+    }
+    if (hits || misses) {
+        if (FILE *f = fopen(stats.c_str(), "w")) {
+            fprintf(f, "%llu %llu\n", oldHits + hits, oldMisses + misses);
+            fclose(f);
+        }
+    }
+    if (!evict)
+        return;
+
+    std::vector<Entry> entries = ListEntries(m_Dir);
+    uint64_t total = 0;
+    for (auto &e : entries)
+        total += e.size;
+    if (total <= m_MaxBytes)
+        return;
+    // least recently used first, down to 90% so not every store has to evict
+    std::sort(entries.begin(), entries.end(), [](const Entry &a, const Entry &b) {
+        return std::tie(a.used, a.path) < std::tie(b.used, b.path);
+    });
+    for (auto &e : entries) {
+        if (total <= m_MaxBytes / 10 * 9)
+            break;
+        if (!llvm::sys::fs::remove(e.path))
+            total -= e.size;
+    }
+}
+
+void CompileCache::PrintStats() {
+    FileLock lock(EntryPath("lock"));
+    unsigned long long hits = 0, misses = 0;
+    if (FILE *f = fopen(EntryPath("stats").c_str(), "r")) {
+        if (fscanf(f, "%llu %llu", &hits, &misses) != 2)
+            hits = misses = 0;
+        fclose(f);
+    }
+    std::vector<Entry> entries = ListEntries(m_Dir);
+    uint64_t total = 0;
+    for (auto &e : entries)
+        total += e.size;
+    fprintf(stderr, "cache %s: %llu hits, %llu misses, %zu entries, %.1f of %.1f MiB\n",
+            m_Dir.c_str(), hits, misses, entries.size(), total / 1048576.0, m_MaxBytes / 1048576.0);
+}
@@ -0,0 +1,39 @@
+#ifndef PJPPROJECT_CACHE_HPP
+#define PJPPROJECT_CACHE_HPP
+
+#include <cstdint>
+#include <string>
+
+#include <llvm/ADT/StringRef.h>
+
+/*
+ * Content-addressed store of compiler outputs (objects, executables, ...) in one
+ * directory. An entry is named by the SHA-1 of the source together with everything
+ * else that decides the output, so a hit is copied out without parsing anything.
+ * Entries are published with an atomic rename. Statistics and eviction of the least
+ * recently used entries are serialized between threads and processes by flock on a
+ * lock file, so parallel builds may share one cache.
+ */
+class CompileCache {
+public:
+    CompileCache(std::string dir, uint64_t maxBytes);
+
+    // key of source compiled under config (compiler, options, target, ...)
+    static std::string Key(llvm::StringRef source, llvm::StringRef config);
+
+    // copies the entry for key to output and counts a hit, or counts a miss
+    bool Fetch(const std::string &key, const std::string &output);
+    // adds output under key, then evicts old entries while the cache is over its size
+    void Store(const std::string &key, const std::string &output);
+    // prints hits, misses, entries and size to stderr
+    void PrintStats();
+private:
+    // runs under the lock: adds to the counters and, if evict, trims the cache
+    void Update(uint64_t hits, uint64_t misses, bool evict);
+    std::string EntryPath(const std::string &key) const;
+
+    std::string m_Dir;
+    uint64_t m_MaxBytes;
+};
+
+#endif //PJPPROJECT_CACHE_HPP
@@ -0,0 +1,133 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+/*
+ * Thin client of the compile server (mila --serve). It hands its arguments,
+ * working directory, environment and standard streams over to the server and
+ * exits with the compiler's exit code. Without a server it runs the mila
+ * compiler next to it, so it can always stand in for mila.
+ */
+
+extern char **environ;
+
+// must match ServerRequest in Server.hpp
+struct ServerRequest {
+    unsigned size;
+    unsigned argc;
+};
+
+static void runCompiler(char *argv[]) {
+    static char exe[PATH_MAX];
+    ssize_t n = readlink("/proc/self/exe", exe, sizeof(exe) - 1);
+    char *slash = n > 0 ? memrchr(exe, '/', n) : NULL;
+    if (slash && slash + sizeof("/mila") < exe + sizeof(exe))
+        strcpy(slash, "/mila");
+    else
+        strcpy(exe, "mila");
+    argv[0] = exe;
+    execvp(exe, argv);
+    perror(exe);
+    exit(1);
+}
+
+static int connectServer(void) {
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    // same default as DefaultSocketPath in Server.cpp
+    const char *path = getenv("MILA_SOCKET");
+    const char *dir = getenv("XDG_RUNTIME_DIR");
+    int len = path ? snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", path)
+            : dir ? snprintf(addr.sun_path, sizeof(addr.sun_path), "%s/mila.sock", dir)
+            : snprintf(addr.sun_path, sizeof(addr.sun_path), "/tmp/mila-%u.sock", (unsigned) getuid());
+    if (len < 0 || len >= (int) sizeof(addr.sun_path))
+        return -1;
+    int sock = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (sock >= 0 && connect(sock, (struct sockaddr *) &addr, sizeof(addr)) != 0) {
+        close(sock);
+        return -1;
+    }
+    return sock;
+}
+
+static int writeAll(int fd, const char *p, size_t n) {
+    while (n) {
+        ssize_t w = write(fd, p, n);
+        if (w < 0 && errno == EINTR)
+            continue;
+        if (w <= 0)
+            return 0;
+        p += w;
+        n -= w;
+    }
+    return 1;
+}
+
+int main(int argc, char *argv[]) {
+    int sock = connectServer();
+    char cwd[PATH_MAX];
+    if (sock < 0 || !getcwd(cwd, sizeof(cwd)))
+        runCompiler(argv);
+
+    // working directory, arguments and environment, each NUL terminated
+    size_t size = strlen(cwd) + 1;
+    for (int i = 0; i < argc; ++i)
+        size += strlen(argv[i]) + 1;
+    for (char **e = environ; *e; ++e)
+        size += strlen(*e) + 1;
+    char *payload = malloc(size), *p = payload;
+    if (!payload)
+        runCompiler(argv);
+    p = stpcpy(p, cwd) + 1;
+    for (int i = 0; i < argc; ++i)
+        p = stpcpy(p, argv[i]) + 1;
+    for (char **e = environ; *e; ++e)
+        p = stpcpy(p, *e) + 1;
+
+    struct ServerRequest request = {(unsigned) size, (unsigned) argc};
+    struct iovec iov = {&request, sizeof(request)};
+    int fds[3] = {0, 1, 2};
+    union {
+        char buffer[CMSG_SPACE(sizeof(fds))];
+        struct cmsghdr align;
+    } control;
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.buffer;
+    msg.msg_controllen = sizeof(control.buffer);
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(fds));
+    memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+    // nothing has happened yet if the streams cannot be passed, compile here instead
+    if (sendmsg(sock, &msg, 0) != sizeof(request))
+        runCompiler(argv);
+    if (!writeAll(sock, payload, size)) {
+        fprintf(stderr, "Lost the connection to the compile server.\n");
+        return 1;
+    }
+
+    int rc;
+    size_t got = 0;
+    while (got < sizeof(rc)) {
+        ssize_t r = read(sock, (char *) &rc + got, sizeof(rc) - got);
+        if (r < 0 && errno == EINTR)
+            continue;
+        if (r <= 0) {
+            fprintf(stderr, "The compile server crashed.\n");
+            return 1;
+        }
+        got += r;
+    }
+    return rc;
+}
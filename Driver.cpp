@@ -0,0 +1,417 @@
+#include "Driver.hpp"
+
+#include "Backend.hpp"
+#include "Cache.hpp"
+#include "Jit.hpp"
+#include "Optimizer.hpp"
+#include "Parser.hpp"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+
+#include <llvm/Bitcode/BitcodeReader.h>
+#include <llvm/Bitcode/BitcodeWriter.h>
+#include <llvm/Config/llvm-config.h>
+#include <llvm/Support/Host.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/ThreadPool.h>
+#include <llvm/Support/TimeProfiler.h>
+#include <llvm/Transforms/Utils/SplitModule.h>
+#include <llvm/Support/raw_ostream.h>
+
+namespace {
+
+// reports the time since the previous step to stderr when enabled, and to the time report if any
+class StepTimer {
+public:
+    StepTimer(bool enabled, TimeReport *report, MemReport *memory)
+        : m_Enabled(enabled), m_Report(report), m_Memory(memory), m_Start(std::chrono::steady_clock::now()), m_Last(m_Start) {}
+    void Step(const char *name) {
+        auto now = std::chrono::steady_clock::now();
+        double ms = std::chrono::duration<double, std::milli>(now - m_Last).count();
+        if (m_Enabled)
+            fprintf(stderr, "  %-8s %8.3f ms\n", name, ms);
+        if (m_Report)
+            m_Report->Phase(name, ms);
+        if (m_Memory)
+            m_Memory->Phase(name);
+        m_Last = now;
+    }
+    void Total() {
+        if (m_Enabled)
+            fprintf(stderr, "  %-8s %8.3f ms\n", "total",
+                    std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_Start).count());
+        if (m_Report)
+            m_Report->Print(llvm::errs());
+        if (m_Memory)
+            m_Memory->Print(llvm::errs());
+    }
+private:
+    bool m_Enabled;
+    TimeReport *m_Report;
+    MemReport *m_Memory;
+    std::chrono::steady_clock::time_point m_Start, m_Last;
+};
+
+// records a Chrome trace of this thread while it exists, if path is not empty
+class TraceFile {
+public:
+    explicit TraceFile(const std::string &path) : m_Path(path) {
+        if (!m_Path.empty())
+            llvm::timeTraceProfilerInitialize(100, "mila");  // events under 100 us are left out
+    }
+    ~TraceFile() {
+        if (m_Path.empty())
+            return;
+        if (auto err = llvm::timeTraceProfilerWrite(m_Path, "mila"))
+            printf("Cannot write %s: %s.\n", m_Path.c_str(), llvm::toString(std::move(err)).c_str());
+        llvm::timeTraceProfilerCleanup();
+    }
+private:
+    std::string m_Path;
+};
+
+std::string BatchOutput(const std::string &input, EmitKind emit, const std::string &outDir) {
+    const char *ext = "";
+    switch (emit) {
+        case EmitKind::IR: ext = "ll"; break;
+        case EmitKind::Bitcode: ext = "bc"; break;
+        case EmitKind::Assembly: ext = "s"; break;
+        case EmitKind::Object: ext = "o"; break;
+        case EmitKind::Executable: break;
+    }
+    llvm::SmallString<128> path(input);
+    llvm::sys::path::replace_extension(path, ext);
+    if (outDir.empty())
+        return std::string(path.str());
+    llvm::SmallString<128> out(outDir);
+    llvm::sys::path::append(out, llvm::sys::path::filename(path));
+    return std::string(out.str());
+}
+
+/*
+ * Splits module by function into options.partitions parts, then optimizes each
+ * part and emits it to a temporary object file on the thread pool, every part in
+ * a context of its own (they travel as bitcode). The parts and their objects only
+ * depend on the partition count, never on the number of threads. Calls between
+ * parts are not inlined.
+ */
+bool EmitPartitions(llvm::Module &module, const CompileOptions &options, std::vector<std::string> &objects) {
+    std::vector<llvm::SmallString<0>> parts;
+    llvm::SplitModule(module, options.partitions, [&](std::unique_ptr<llvm::Module> part) {
+        parts.emplace_back();
+        llvm::raw_svector_ostream os(parts.back());
+        llvm::WriteBitcodeToFile(*part, os);
+    });
+
+    objects.assign(parts.size(), std::string());
+    std::vector<char> done(parts.size(), 0);
+    llvm::ThreadPool pool(llvm::hardware_concurrency(options.jobs));
+    for (size_t i = 0; i < parts.size(); ++i) {
+        pool.async([&, i] {
+            llvm::LLVMContext context;
+            auto part = llvm::parseBitcodeFile(llvm::MemoryBufferRef(parts[i].str(), "part"), context);
+            if (!part) {
+                llvm::consumeError(part.takeError());
+                return;
+            }
+            auto tm = CreateTargetMachine(options.level, options.cpu);
+            if (!OptimizeModule(**part, tm.get(), options.level, nullptr, options.profileGenerate, options.profileUse))
+                return;
+            llvm::SmallString<128> object;
+            int fd;
+            if (llvm::sys::fs::createTemporaryFile("mila", "o", fd, object))
+                return;
+            objects[i] = std::string(object.str());
+            llvm::raw_fd_ostream out(fd, true);
+            done[i] = EmitCode(**part, *tm, llvm::CGFT_ObjectFile, out);
+        });
+    }
+    pool.wait();
+
+    for (size_t i = 0; i < parts.size(); ++i) {
+        if (!done[i]) {
+            printf("Cannot emit partition %zu.\n", i);
+            return false;
+        }
+    }
+    return true;
+}
+
+void RemoveObjects(const std::vector<std::string> &objects) {
+    for (auto &o : objects)
+        if (!o.empty())
+            llvm::sys::fs::remove(o);
+}
+
+// path, size and modification time, enough to notice a rebuilt or replaced file
+void DescribeFile(llvm::raw_ostream &os, const std::string &path) {
+    llvm::sys::fs::file_status st;
+    os << ' ' << path;
+    if (!llvm::sys::fs::status(path, st))
+        os << ' ' << st.getSize() << ' ' << st.getLastModificationTime().time_since_epoch().count();
+}
+
+// everything besides the source that the output of a compilation depends on
+std::string CacheConfig(const CompileOptions &options) {
+    std::string config;
+    llvm::raw_string_ostream os(config);
+    // the compiler itself, so a rebuilt compiler does not reuse old outputs
+    DescribeFile(os, llvm::sys::fs::getMainExecutable(nullptr, nullptr));
+    std::string cpu, features;
+    ResolveCPU(options.cpu, cpu, features);
+    os << " llvm " << LLVM_VERSION_STRING << ' ' << llvm::sys::getDefaultTargetTriple() << ' ' << cpu << ' ' << features
+       << " -O" << options.level.getSpeedupLevel() << '.' << options.level.getSizeLevel()
+       << " emit " << (int) options.emit << " split " << options.partitions
+       << " bounds " << options.boundsCheck << " wrapv " << options.wrapv << " profile " << options.profile
+       << " profile-generate " << options.profileGenerate;
+    if (!options.profileUse.empty())
+        DescribeFile(os, options.profileUse);
+    if (!options.runtimeBitcode.empty())
+        DescribeFile(os, options.runtimeBitcode);
+    if (options.emit == EmitKind::Executable) {
+        DescribeFile(os, options.runtime);
+        os << ' ' << options.linker << " static " << options.staticLink;
+    }
+    return os.str();
+}
+
+int CompileFile(const CompileOptions &options, const std::string &input, const std::string &output, size_t *lines) {
+    TraceFile trace(options.timeTrace);
+    std::unique_ptr<TimeReport> report;
+    if (options.timeReport)
+        report = std::make_unique<TimeReport>();
+    std::unique_ptr<MemReport> memory;
+    if (options.memReport)
+        memory = std::make_unique<MemReport>();
+    StepTimer timer(options.timing, report.get(), memory.get());
+    int fd = STDIN_FILENO;
+    if (input != "-") {
+        fd = open(input.c_str(), O_RDONLY);
+        if (fd < 0) {
+            printf("Cannot open %s.\n", input.c_str());
+            return 1;
+        }
+    }
+    Parser parser(fd);
+    if (fd != STDIN_FILENO)
+        close(fd);
+    if (lines)
+        *lines = parser.SourceLines();
+    parser.BoundsCheck = options.boundsCheck;
+    parser.WrapArithmetic = options.wrapv;
+    parser.ProfileFunctions = options.profile;
+    parser.GenerateProfile = !options.profileGenerate.empty();
+    parser.Report = report.get();
+    parser.Memory = memory.get();
+
+    if (!parser.Parse()) {
+        return 1;
+    }
+    timer.Step("parse");
+    parser.Fold();
+    timer.Step("fold");
+
+    auto tm = CreateTargetMachine(options.level, options.cpu);
+    ConfigureModule(parser.MilaModule, *tm);
+
+    if (!parser.Generate())
+        return 1;
+    timer.Step("codegen");
+    if (memory)
+        memory->CountModule(parser.MilaModule);
+    if (!options.runtimeBitcode.empty()) {
+        if (!LinkRuntime(parser.MilaModule, options.runtimeBitcode))
+            return 1;
+        timer.Step("runtime");
+    }
+
+    if (options.partitions > 1) {
+        if (options.run || (options.emit != EmitKind::Object && options.emit != EmitKind::Executable)) {
+            printf("Partitioned compilation only emits objects and executables.\n");
+            return 1;
+        }
+        if (output == "-") {
+            printf("Partitioned compilation needs an output file name.\n");
+            return 1;
+        }
+        std::vector<std::string> objects;
+        bool ok = EmitPartitions(parser.MilaModule, options, objects);
+        timer.Step("parts");
+        if (ok && options.emit == EmitKind::Executable)
+            ok = LinkExecutable(objects, options.runtime, options.linker, options.staticLink, output);
+        else if (ok)
+            ok = LinkRelocatable(objects, options.linker, output);
+        RemoveObjects(objects);
+        timer.Step("link");
+        timer.Total();
+        return ok ? 0 : 1;
+    }
+    if (!OptimizeModule(parser.MilaModule, tm.get(), options.level, report.get(), options.profileGenerate,
+                        options.profileUse))
+        return 1;
+    timer.Step("optimize");
+    if (report)
+        report->CountIR(parser.MilaModule);
+    if (memory)
+        memory->CountModule(parser.MilaModule);
+
+    if (options.run) {
+        auto owned = parser.TakeModule();
+        int rc = RunJit(std::move(owned.first), std::move(owned.second), options.timing);
+        timer.Total();
+        return rc;
+    }
+
+    if (options.emit == EmitKind::Executable) {
+        if (output == "-") {
+            printf("Executables need an output file name.\n");
+            return 1;
+        }
+        llvm::SmallString<128> object;
+        int objfd;
+        if (llvm::sys::fs::createTemporaryFile("mila", "o", objfd, object)) {
+            printf("Cannot create temporary object file.\n");
+            return 1;
+        }
+        bool ok;
+        {
+            llvm::raw_fd_ostream out(objfd, true);
+            ok = EmitCode(parser.MilaModule, *tm, llvm::CGFT_ObjectFile, out);
+        }
+        timer.Step("emit");
+        ok = ok && LinkExecutable({std::string(object.str())}, options.runtime, options.linker, options.staticLink, output);
+        llvm::sys::fs::remove(object);
+        timer.Step("link");
+        timer.Total();
+        return ok ? 0 : 1;
+    }
+
+    std::error_code ec;
+    llvm::raw_fd_ostream out(output, ec, options.emit == EmitKind::IR || options.emit == EmitKind::Assembly
+                                          ? llvm::sys::fs::OF_Text : llvm::sys::fs::OF_None);
+    if (ec) {
+        printf("Cannot open %s: %s.\n", output.c_str(), ec.message().c_str());
+        return 1;
+    }
+    bool ok = true;
+    switch (options.emit) {
+        case EmitKind::IR:
+            parser.MilaModule.print(out, nullptr);
+            break;
+        case EmitKind::Bitcode:
+            llvm::WriteBitcodeToFile(parser.MilaModule, out);
+            break;
+        case EmitKind::Assembly:
+            ok = EmitCode(parser.MilaModule, *tm, llvm::CGFT_AssemblyFile, out);
+            break;
+        case EmitKind::Object:
+            ok = EmitCode(parser.MilaModule, *tm, llvm::CGFT_ObjectFile, out);
+            break;
+        default:
+            ok = false;
+    }
+    timer.Step("emit");
+    timer.Total();
+    return ok ? 0 : 1;
+}
+
+}
+
+int Compile(const CompileOptions &options, const std::string &input, const std::string &output, size_t *lines) {
+    // only files are cached: standard input would have to be read up front and --run has no output
+    if (options.cacheDir.empty() || input == "-" || output == "-" || options.run)
+        return CompileFile(options, input, output, lines);
+    auto source = llvm::MemoryBuffer::getFile(input);
+    if (!source)
+        return CompileFile(options, input, output, lines);
+
+    CompileCache cache(options.cacheDir, options.cacheSize);
+    std::string key = CompileCache::Key((*source)->getBuffer(), CacheConfig(options));
+    if (cache.Fetch(key, output)) {
+        if (lines) {
+            llvm::StringRef text = (*source)->getBuffer();
+            *lines = text.count('\n') + (!text.empty() && text.back() != '\n');
+        }
+        if (options.timing)
+            fprintf(stderr, "  cached   %s\n", key.c_str());
+        return 0;
+    }
+    int rc = CompileFile(options, input, output, lines);
+    if (rc == 0)
+        cache.Store(key, output);
+    return rc;
+}
+
+int CompileBatch(const CompileOptions &options, const std::vector<std::string> &inputs,
+                 const std::string &outDir, unsigned jobs) {
+    if (options.run) {
+        printf("--run takes a single input.\n");
+        return 1;
+    }
+    CompileOptions fileOptions = options;
+    fileOptions.timing = false;
+    fileOptions.timeReport = false;
+    fileOptions.timeTrace.clear();
+    fileOptions.memReport = false;  // the counters are process wide
+
+    std::vector<int> results(inputs.size());
+    std::atomic<size_t> lines(0);
+    auto start = std::chrono::steady_clock::now();
+    llvm::ThreadPool pool(llvm::hardware_concurrency(jobs));
+    for (size_t i = 0; i < inputs.size(); ++i) {
+        pool.async([&, i] {
+            size_t n = 0;
+            results[i] = Compile(fileOptions, inputs[i], BatchOutput(inputs[i], options.emit, outDir), &n);
+            lines += n;
+        });
+    }
+    pool.wait();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    int failed = 0;
+    for (size_t i = 0; i < inputs.size(); ++i) {
+        if (results[i]) {
+            printf("Compilation of %s failed.\n", inputs[i].c_str());
+            ++failed;
+        }
+    }
+    fprintf(stderr, "%zu files, %zu lines in %.3f s on %u threads: %.1f files/s, %.0f lines/s\n",
+            inputs.size(), lines.load(), seconds, pool.getThreadCount(),
+            inputs.size() / seconds, lines.load() / seconds);
+    return failed ? 1 : 0;
+}
+
+void WarmUp() {
+    static const char program[] =
+            "program warmup;\n"
+            "var i, s : integer;\n"
+            "begin\n"
+            "    s := 0;\n"
+            "    for i := 1 to 10 do\n"
+            "        s := s + i;\n"
+            "    writeln(s);\n"
+            "end.\n";
+    int fds[2];
+    if (pipe(fds) != 0)
+        return;
+    // small enough for the pipe buffer, so this cannot block
+    bool sent = write(fds[1], program, sizeof(program) - 1) == (ssize_t) sizeof(program) - 1;
+    close(fds[1]);
+    Parser parser(fds[0]);
+    close(fds[0]);
+    if (!sent || !parser.Parse())
+        return;
+    parser.Fold();
+    auto tm = CreateTargetMachine(llvm::OptimizationLevel::O2);
+    ConfigureModule(parser.MilaModule, *tm);
+    parser.Generate();
+    OptimizeModule(parser.MilaModule, tm.get(), llvm::OptimizationLevel::O2);
+    llvm::raw_null_ostream out;
+    EmitCode(parser.MilaModule, *tm, llvm::CGFT_ObjectFile, out);
+}
@@ -0,0 +1,61 @@
+#ifndef PJPPROJECT_DRIVER_HPP
+#define PJPPROJECT_DRIVER_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <llvm/Passes/OptimizationLevel.h>
+
+enum class EmitKind {IR, Bitcode, Assembly, Object, Executable};
+
+struct CompileOptions {
+    llvm::OptimizationLevel level = llvm::OptimizationLevel::O0;
+    EmitKind emit = EmitKind::IR;
+    std::string cpu = "native";      // CPU the code is tuned for and may use the features of (-mcpu)
+    bool staticLink = false;         // link executables with -static
+    std::string runtime;             // runtime library linked into executables (fce.c)
+    std::string runtimeBitcode;      // runtime as bitcode merged into the module, empty to call the library
+    std::string linker;              // C compiler driver used for the final link
+    bool run = false;                // run main() in process with the JIT instead of emitting anything
+    bool timing = false;             // print how long each step took to stderr
+    bool timeReport = false;         // print where the time went by phase, pass and function to stderr
+    std::string timeTrace;           // write a Chrome trace (chrome://tracing) of the compilation here
+    bool memReport = false;          // print allocations, heap and peak RSS by phase and what the parser holds to stderr
+    bool boundsCheck = false;        // check array indexes at run time
+    bool wrapv = false;              // signed overflow wraps around instead of being undefined
+    bool profile = false;            // count calls and cycles per function, the program prints them when main ends
+    std::string profileGenerate;     // instrument for profile-guided optimization, the program writes this raw profile
+    std::string profileUse;          // optimize with this indexed profile (llvm-profdata merge of raw ones)
+    unsigned partitions = 1;         // optimize and emit the module in this many parts, in parallel
+    unsigned jobs = 0;               // worker threads for partitions, 0 is one per core
+    std::string cacheDir;            // reuse outputs of identical compilations stored here, empty for no cache
+    uint64_t cacheSize = 512 << 20;  // bytes the cache may hold before old entries are evicted
+};
+
+/*
+ * Compiles one Mila program from input ("-" is standard input) to output
+ * ("-" is standard output) entirely in process, except for the final link
+ * of executables. With options.run the program is executed instead.
+ * With options.cacheDir a file compiled before under the same options is
+ * copied from the cache. Returns the exit code for the process.
+ */
+int Compile(const CompileOptions &options, const std::string &input, const std::string &output,
+            size_t *lines = nullptr);
+
+/*
+ * Compiles every input on a pool of jobs worker threads (0: one per core), each
+ * file with its own Parser and LLVM context. Outputs go next to the inputs, or
+ * into outDir, named after them. Prints files/s and lines/s to stderr.
+ * Returns the exit code for the process.
+ */
+int CompileBatch(const CompileOptions &options, const std::vector<std::string> &inputs,
+                 const std::string &outDir, unsigned jobs);
+
+/*
+ * Compiles a small built-in program through every step without writing anything,
+ * so LLVM state that is built on first use exists before a server forks.
+ */
+void WarmUp();
+
+#endif //PJPPROJECT_DRIVER_HPP
@@ -0,0 +1,24 @@
+#include "Interner.hpp"
+
+#include <cstring>
+
+int Interner::Intern(std::string_view name) {
+    auto it = m_Ids.find(name);
+    if (it != m_Ids.end())
+        return it->second;
+    char *text = (char *) m_Text.Allocate(name.size() + 1, 1);
+    memcpy(text, name.data(), name.size());
+    text[name.size()] = 0;
+    std::string_view stored(text, name.size());
+    int id = m_Names.size();
+    m_Names.push_back(stored);
+    m_Ids.emplace(stored, id);
+    return id;
+}
+
+size_t Interner::Bytes() const {
+    // a node holds the pair and the next pointer, the buckets are one pointer each
+    size_t node = sizeof(void *) + sizeof(std::pair<const std::string_view, int>);
+    return m_Text.BytesReserved() + m_Names.capacity() * sizeof(std::string_view)
+           + m_Ids.bucket_count() * sizeof(void *) + m_Ids.size() * node;
+}
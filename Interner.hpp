@@ -0,0 +1,27 @@
+#ifndef PJPPROJECT_INTERNER_HPP
+#define PJPPROJECT_INTERNER_HPP
+
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "Arena.hpp"
+
+/*
+ * Maps every distinct identifier to a small dense integer, so later phases can
+ * compare and index names instead of hashing strings. Ids are handed out in
+ * order of first appearance, starting at 0.
+ */
+class Interner {
+public:
+    int Intern(std::string_view name);
+    std::string_view Name(int id) const { return m_Names[id]; }
+    size_t Size() const { return m_Names.size(); }
+    size_t Bytes() const;   // about the memory held, the hash table's nodes are estimated
+private:
+    Arena m_Text;                                  // owns the characters of every name
+    std::vector<std::string_view> m_Names;
+    std::unordered_map<std::string_view, int> m_Ids;
+};
+
+#endif //PJPPROJECT_INTERNER_HPP
@@ -0,0 +1,73 @@
+#include "Jit.hpp"
+
+#include <chrono>
+#include <cstdio>
+
+#include <llvm/ExecutionEngine/Orc/ExecutionUtils.h>
+#include <llvm/ExecutionEngine/Orc/LLJIT.h>
+#include <llvm/Support/Error.h>
+#include <llvm/Support/raw_ostream.h>
+
+extern "C" {
+int mila_rt_writeln(int x);
+int mila_rt_write(int x);
+int mila_rt_readln(int *x);
+void mila_rt_boundserror(int index, int low, int high);
+void mila_rt_flushout(void);
+void mila_rt_profdump(int count, long long **records, const char **names);
+}
+
+int RunJit(std::unique_ptr<llvm::LLVMContext> context, std::unique_ptr<llvm::Module> module, bool timing) {
+    auto start = std::chrono::steady_clock::now();
+
+    auto jit = llvm::orc::LLJITBuilder().create();
+    if (!jit) {
+        llvm::errs() << "Cannot create JIT: " << llvm::toString(jit.takeError()) << "\n";
+        return -1;
+    }
+    auto &J = **jit;
+    auto &dylib = J.getMainJITDylib();
+
+    auto mangle = llvm::orc::MangleAndInterner(J.getExecutionSession(), J.getDataLayout());
+    auto flags = llvm::JITSymbolFlags::Exported | llvm::JITSymbolFlags::Callable;
+    llvm::orc::SymbolMap runtime = {
+            {mangle("writeln"), {llvm::pointerToJITTargetAddress(&mila_rt_writeln), flags}},
+            {mangle("write"), {llvm::pointerToJITTargetAddress(&mila_rt_write), flags}},
+            {mangle("readln"), {llvm::pointerToJITTargetAddress(&mila_rt_readln), flags}},
+            {mangle("boundserror"), {llvm::pointerToJITTargetAddress(&mila_rt_boundserror), flags}},
+            {mangle("flushout"), {llvm::pointerToJITTargetAddress(&mila_rt_flushout), flags}},
+            {mangle("profdump"), {llvm::pointerToJITTargetAddress(&mila_rt_profdump), flags}},
+    };
+    llvm::Error err = dylib.define(llvm::orc::absoluteSymbols(std::move(runtime)));
+    auto process = llvm::orc::DynamicLibrarySearchGenerator::GetForCurrentProcess(J.getDataLayout().getGlobalPrefix());
+    if (!err && process)
+        dylib.addGenerator(std::move(*process));
+    else if (!process)
+        err = llvm::joinErrors(std::move(err), process.takeError());
+
+    module->setDataLayout(J.getDataLayout());
+    if (!err)
+        err = J.addIRModule(llvm::orc::ThreadSafeModule(std::move(module), std::move(context)));
+    if (err) {
+        llvm::errs() << "Cannot load module into JIT: " << llvm::toString(std::move(err)) << "\n";
+        return -1;
+    }
+
+    auto mainSym = J.lookup("main");
+    if (!mainSym) {
+        llvm::errs() << "Cannot compile main: " << llvm::toString(mainSym.takeError()) << "\n";
+        return -1;
+    }
+    auto compiled = std::chrono::steady_clock::now();
+
+    auto *mainFn = (int (*)()) mainSym->getAddress();
+    int rc = mainFn();
+    fflush(stdout);
+    auto done = std::chrono::steady_clock::now();
+
+    if (timing)
+        fprintf(stderr, "  jit      %8.3f ms\n  run      %8.3f ms\n",
+                std::chrono::duration<double, std::milli>(compiled - start).count(),
+                std::chrono::duration<double, std::milli>(done - compiled).count());
+    return rc;
+}
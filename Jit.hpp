@@ -0,0 +1,17 @@
+#ifndef PJPPROJECT_JIT_HPP
+#define PJPPROJECT_JIT_HPP
+
+#include <memory>
+
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/Module.h>
+
+/*
+ * Runs main() of the module in this process with ORC LLJIT. The runtime
+ * routines (writeln, write, readln, ...) resolve to the compiler's own copy
+ * of fce.c, anything else to symbols of the host process.
+ * Returns the exit code of the program, or -1 if it could not be started.
+ */
+int RunJit(std::unique_ptr<llvm::LLVMContext> context, std::unique_ptr<llvm::Module> module, bool timing);
+
+#endif //PJPPROJECT_JIT_HPP
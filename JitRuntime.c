@@ -0,0 +1,3 @@
+/* the Mila runtime as linked into the compiler itself, for programs run by the JIT */
+#define MILA_RT(name) mila_rt_##name
+#include "fce.c"
@@ -1,14 +1,79 @@
 #include "Lexer.hpp"
 
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+Lexer::Lexer() : Lexer(STDIN_FILENO) {
+}
+
+Lexer::Lexer(int fd) {
+    loadInput(fd);
+    readInput();
+}
+
+Lexer::~Lexer() {
+    if (m_Mapped)
+        munmap((void *) m_Begin, m_Mapped);
+}
+
+size_t Lexer::lineCount() const {
+    size_t lines = std::count(m_Begin, m_End, '\n');
+    return m_End > m_Begin && m_End[-1] != '\n' ? lines + 1 : lines;
+}
+
 /**
- * @brief Function to return the next token from standard input
+ * @brief Makes the whole source text available in memory
+ *
+ * Regular files are mapped, anything else (pipes, terminals) is read in large blocks.
+ * Identifiers returned by the lexer point directly into this buffer.
+ */
+void Lexer::loadInput(int fd) {
+    struct stat st;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+        off_t offset = lseek(fd, 0, SEEK_CUR);
+        if (offset < 0)
+            offset = 0;
+        void *map = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map != MAP_FAILED) {
+            madvise(map, st.st_size, MADV_SEQUENTIAL);
+            m_Mapped = st.st_size;
+            m_Begin = (const char *) map;
+            m_Pos = m_Begin + (offset < st.st_size ? offset : st.st_size);
+            m_End = m_Begin + st.st_size;
+            return;
+        }
+    }
+    const size_t block = 1 << 16;
+    size_t len = 0;
+    for (;;) {
+        m_Storage.resize(len + block);
+        ssize_t n = read(fd, m_Storage.data() + len, block);
+        if (n < 0) {
+            perror("read");
+            m_ReadFailed = true;
+            break;
+        }
+        if (n == 0)
+            break;
+        len += n;
+    }
+    m_Storage.resize(len);
+    m_Begin = m_Pos = m_Storage.data();
+    m_End = m_Begin + len;
+}
+
+/**
+ * @brief Function to return the next token from the source buffer
  *
  * the variable 'm_IdentifierStr' is set there in case of an identifier,
  * the variable 'm_NumVal' is set there in case of a number.
  */
 
 void Lexer::readInput(void) {
-    character = getchar();
+    character = m_Pos < m_End ? (unsigned char) *m_Pos++ : EOF;
     if ((character>='A' && character<='Z') || (character>='a' && character<='z') || character=='_')
         input = LETTER;
     else if (character>='0' && character<='9')
@@ -26,7 +91,11 @@ const char oneChSymbTable[13] = {
         '+','-','*','/','=','.',',',';', '(', ')', '[', ']', 0
 };
 
-const struct {std::string slovo; Token symb;} keyWordTable[] = {
+namespace {
+
+struct KeyWord {std::string_view slovo; Token symb;};
+
+constexpr KeyWord keyWordTable[] = {
         {"begin", tok_begin},
         {"end", tok_end},
         {"const", tok_const},
@@ -52,18 +121,68 @@ const struct {std::string slovo; Token symb;} keyWordTable[] = {
         {"break", tok_break},
         {"to", tok_to},
         {"downto", tok_downto},
-        {"", (Token) 0}
+        {"array", tok_array},
+        {"of", tok_of},
 };
 
-int keyWord(std::string id) {
-    int i = 0;
-    while (!keyWordTable[i].slovo.empty())
-        if (id==keyWordTable[i].slovo)
-            return keyWordTable[i].symb;
-        else
-            i++;
+/*
+ * Perfect hash over keyWordTable: slot = (first * mulFirst + last + length * mulLen) mod 64.
+ * The multipliers are searched for at compile time, so the table can be edited freely.
+ */
+struct KeyWordHash {
+    unsigned mulFirst;
+    unsigned mulLen;
+    size_t minLen, maxLen;
+    signed char slot[64];  // index into keyWordTable, -1 if empty
+};
+
+constexpr unsigned keyWordSlot(unsigned mulFirst, unsigned mulLen, std::string_view w) {
+    return ((unsigned char) w.front() * mulFirst + (unsigned char) w.back() + w.size() * mulLen) & 63;
+}
+
+constexpr KeyWordHash buildKeyWordHash() {
+    for (unsigned a = 1; a < 64; ++a)
+        for (unsigned b = 1; b < 64; ++b) {
+            KeyWordHash h{a, b, ~(size_t) 0, 0, {}};
+            for (auto &s : h.slot)
+                s = -1;
+            bool ok = true;
+            for (size_t i = 0; ok && i < sizeof(keyWordTable) / sizeof(keyWordTable[0]); ++i) {
+                const std::string_view w = keyWordTable[i].slovo;
+                unsigned s = keyWordSlot(a, b, w);
+                if (h.slot[s] != -1)
+                    ok = false;
+                h.slot[s] = i;
+                h.minLen = w.size() < h.minLen ? w.size() : h.minLen;
+                h.maxLen = w.size() > h.maxLen ? w.size() : h.maxLen;
+            }
+            if (ok)
+                return h;
+        }
+    return KeyWordHash{0, 0, 0, 0, {}};
+}
+
+constexpr KeyWordHash keyWordHash = buildKeyWordHash();
+static_assert(keyWordHash.mulFirst != 0, "no perfect hash found for keyWordTable");
+
+}
+
+int keyWord(std::string_view id) {
+    if (id.size() < keyWordHash.minLen || id.size() > keyWordHash.maxLen)
+        return tok_identifier;
+    int i = keyWordHash.slot[keyWordSlot(keyWordHash.mulFirst, keyWordHash.mulLen, id)];
+    if (i >= 0 && keyWordTable[i].slovo == id)
+        return keyWordTable[i].symb;
     return tok_identifier;
 }
+
+std::string_view keyWordName(int tok) {
+    for (auto &k : keyWordTable)
+        if (k.symb == tok)
+            return k.slovo;
+    return {};
+}
+
 int isOneChTok(char character){
     int i = 0;
     while (oneChSymbTable[i])
@@ -117,7 +236,7 @@ int Lexer::gettok()
         case END:
             return tok_eof;
         case LETTER:
-            this->m_IdentifierStr=(char)character;
+            this->m_IdentifierStr=std::string_view(m_Pos-1,1);
             readInput();
             goto q2;
         case NUMBER:
@@ -168,7 +287,7 @@ int Lexer::gettok()
     switch(input) {
         case LETTER:
         case NUMBER:
-            m_IdentifierStr+=character;
+            m_IdentifierStr=std::string_view(m_IdentifierStr.data(),m_IdentifierStr.size()+1);
             readInput();
             goto q2;
         default:
@@ -187,8 +306,8 @@ int Lexer::gettok()
                 digit = (character - '0');
             }
             if (digit >= base) {
-                printf("Digit %c not allowed in %d base!",character,base);
-                exit(1);
+                printf("Digit %c not allowed in %d base!\n",character,base);
+                throw SyntaxError();
             }
 
             m_NumVal = base * m_NumVal + digit;
@@ -2,25 +2,47 @@
 #define PJPPROJECT_LEXER_HPP
 
 #include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
 
 typedef enum {LETTER, NUMBER, WHITE_SPACE, END, NO_TYPE} InputCharType;
 
+// thrown after a syntax error has been printed; Parser::Parse catches it and fails
+struct SyntaxError {};
+
 class Lexer {
 public:
-    Lexer() {readInput();};
-    ~Lexer() = default;
+    Lexer();                          // reads standard input
+    explicit Lexer(int fd);           // reads the whole of fd up front, the caller may close it afterwards
+    ~Lexer();
+    Lexer(const Lexer&) = delete;
+    Lexer& operator=(const Lexer&) = delete;
 
     int gettok();
-    const std::string& identifierStr() const { return this->m_IdentifierStr; }
+    // slice of the source buffer, valid for the lifetime of the lexer
+    std::string_view identifierStr() const { return this->m_IdentifierStr; }
     int numVal() { return this->m_NumVal; }
+    size_t lineCount() const;         // lines in the whole source text
+    size_t bufferBytes() const { return m_Mapped ? m_Mapped : m_Storage.capacity(); }  // memory holding the source text
+    bool isMapped() const { return m_Mapped != 0; }
+    bool readFailed() const { return m_ReadFailed; }  // the source could not be read, only part of it is there
 private:
-    std::string m_IdentifierStr;
+    std::string_view m_IdentifierStr;
     int m_NumVal;
     int character;
     InputCharType input; // input symbol type
     void readInput(void) ;
     int base=10;
 
+    void loadInput(int fd);
+    const char *m_Begin=nullptr;     // whole source text, either mapped or in m_Storage
+    const char *m_Pos=nullptr;       // next unread character
+    const char *m_End=nullptr;
+    size_t m_Mapped=0;               // length of the mapping, 0 if the input was read into m_Storage
+    bool m_ReadFailed=false;
+    std::vector<char> m_Storage;
+
 
 };
 
@@ -75,7 +97,14 @@ enum Token {
     // keywords for array
     tok_array =         -32,
 
-    tok_break =        -33
+    tok_break =        -33,
+
+    tok_of =            -34
 };
 
+// keyword token for an identifier, tok_identifier if it is not a keyword
+int keyWord(std::string_view id);
+// spelling of a keyword token, empty for other tokens
+std::string_view keyWordName(int tok);
+
 #endif //PJPPROJECT_LEXER_HPP
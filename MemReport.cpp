@@ -0,0 +1,209 @@
+#include "MemReport.hpp"
+
+#include <cxxabi.h>
+#include <malloc.h>
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#include <llvm/Support/Format.h>
+
+namespace {
+
+// process wide, the optimizer of a --split compilation allocates on other threads
+std::atomic<bool> g_Counting{false};
+std::atomic<size_t> g_Allocations{0}, g_Allocated{0}, g_Freed{0};
+std::atomic<long> g_Peak{0};                 // highest allocated - freed since the last phase ended
+
+// sizes are what malloc really handed out, the same on allocation and release
+void CountNew(void *p) {
+    size_t size = malloc_usable_size(p);
+    g_Allocations.fetch_add(1, std::memory_order_relaxed);
+    long live = (long) (g_Allocated.fetch_add(size, std::memory_order_relaxed) + size
+                        - g_Freed.load(std::memory_order_relaxed));
+    long peak = g_Peak.load(std::memory_order_relaxed);
+    while (live > peak && !g_Peak.compare_exchange_weak(peak, live, std::memory_order_relaxed)) {
+    }
+}
+
+void CountDelete(void *p) {
+    g_Freed.fetch_add(malloc_usable_size(p), std::memory_order_relaxed);
+}
+
+long PeakRSS() {
+    struct rusage usage;
+    return getrusage(RUSAGE_SELF, &usage) == 0 ? usage.ru_maxrss : 0;
+}
+
+double KiB(double bytes) {
+    return bytes / 1024;
+}
+
+std::string TypeName(const std::type_index &type) {
+    int status;
+    char *name = abi::__cxa_demangle(type.name(), nullptr, nullptr, &status);
+    std::string result = name ? name : type.name();
+    free(name);
+    return result;
+}
+
+}
+
+/*
+ * The replaceable global allocation functions. libstdc++ implements the array
+ * and nothrow forms on top of these two, so they see every allocation made
+ * through new (by the compiler and by LLVM) but none made through malloc. The
+ * sized and array deletes are defined as well, so none of them can bypass the
+ * counting delete, whatever the library does.
+ */
+void *operator new(size_t size) {
+    for (;;) {
+        if (void *p = malloc(size ? size : 1)) {
+            if (g_Counting.load(std::memory_order_relaxed))
+                CountNew(p);
+            return p;
+        }
+        std::new_handler handler = std::get_new_handler();
+        if (!handler)
+            throw std::bad_alloc();
+        handler();
+    }
+}
+
+void operator delete(void *p) noexcept {
+    if (p && g_Counting.load(std::memory_order_relaxed))
+        CountDelete(p);
+    free(p);
+}
+
+void operator delete(void *p, size_t) noexcept {
+    operator delete(p);
+}
+
+void operator delete[](void *p) noexcept {
+    operator delete(p);
+}
+
+void operator delete[](void *p, size_t) noexcept {
+    operator delete(p);
+}
+
+MemReport::MemReport() {
+    g_Allocations = 0;
+    g_Allocated = 0;
+    g_Freed = 0;
+    g_Peak = 0;
+    g_Counting = true;
+}
+
+MemReport::~MemReport() {
+    g_Counting = false;
+}
+
+MemReport::Heap MemReport::Counters() {
+    Heap heap;
+    heap.allocations = g_Allocations.load(std::memory_order_relaxed);
+    heap.allocated = g_Allocated.load(std::memory_order_relaxed);
+    heap.freed = g_Freed.load(std::memory_order_relaxed);
+    return heap;
+}
+
+void MemReport::Phase(const char *name) {
+    Heap now = Counters();
+    PhaseRow row;
+    row.name = name;
+    row.heap.allocations = now.allocations - m_Last.allocations;
+    row.heap.allocated = now.allocated - m_Last.allocated;
+    row.heap.freed = now.freed - m_Last.freed;
+    row.live = now.live();
+    // the next phase starts from what is held now
+    row.peak = std::max(g_Peak.exchange(row.live, std::memory_order_relaxed), row.live);
+    row.rss = PeakRSS();
+    m_Phases.push_back(row);
+    m_Last = now;
+}
+
+void MemReport::AddLexing(const Heap &before) {
+    Heap now = Counters();
+    m_Lexing.allocations += now.allocations - before.allocations;
+    m_Lexing.allocated += now.allocated - before.allocated;
+    m_Lexing.freed += now.freed - before.freed;
+}
+
+void MemReport::Made(const std::type_info &type, size_t size) {
+    Count &count = m_Nodes[std::type_index(type)];
+    ++count.objects;
+    count.bytes += size;
+}
+
+void MemReport::Component(const char *name, size_t bytes, const char *detail) {
+    m_Components.push_back({name, detail, bytes});
+}
+
+void MemReport::CountModule(const llvm::Module &module) {
+    ModuleRow row{std::string(), 0, 0, 0, 0};
+    if (!m_Phases.empty()) {
+        row.phase = m_Phases.back().name;
+        row.heap = m_Phases.back().heap.live();
+    }
+    for (const llvm::Function &F : module) {
+        if (F.isDeclaration())
+            continue;
+        ++row.functions;
+        row.blocks += F.size();
+        row.instructions += F.getInstructionCount();
+    }
+    m_Modules.push_back(row);
+}
+
+void MemReport::Print(llvm::raw_ostream &os) const {
+    os << llvm::format("%-32s %12s %12s %12s %12s %12s\n", (const char *) "Memory report (KiB)", (const char *) "allocations",
+                       (const char *) "allocated", (const char *) "heap change", (const char *) "heap peak",
+                       (const char *) "peak RSS");
+    Heap total;
+    long peak = 0, rss = 0;
+    for (auto &phase : m_Phases) {
+        os << llvm::format("  %-30s %12zu %12.1f %+12.1f %12.1f %12ld\n", phase.name.c_str(), phase.heap.allocations,
+                           KiB(phase.heap.allocated), KiB(phase.heap.live()), KiB(phase.peak), phase.rss);
+        if (phase.name == "parse")
+            os << llvm::format("    %-28s %12zu %12.1f  of parse\n", (const char *) "lex", m_Lexing.allocations,
+                               KiB(m_Lexing.allocated));
+        total.allocations += phase.heap.allocations;
+        total.allocated += phase.heap.allocated;
+        total.freed += phase.heap.freed;
+        peak = std::max(peak, phase.peak);
+        rss = std::max(rss, phase.rss);
+    }
+    os << llvm::format("  %-30s %12zu %12.1f %+12.1f %12.1f %12ld\n", (const char *) "total", total.allocations,
+                       KiB(total.allocated), KiB(total.live()), KiB(peak), rss);
+
+    os << llvm::format("%-32s %12s %12s\n", (const char *) "Held by the parser (KiB)", (const char *) "", (const char *) "bytes");
+    for (auto &c : m_Components)
+        os << llvm::format("  %-30s %12s %12.1f  ", c.name.c_str(), (const char *) "", KiB(c.bytes)) << c.detail << '\n';
+
+    // largest share of the arena first
+    std::vector<std::pair<std::string, Count>> nodes;
+    Count arena;
+    for (auto &n : m_Nodes) {
+        nodes.emplace_back(TypeName(n.first), n.second);
+        arena.objects += n.second.objects;
+        arena.bytes += n.second.bytes;
+    }
+    std::sort(nodes.begin(), nodes.end(), [](auto &a, auto &b) {
+        return a.second.bytes != b.second.bytes ? a.second.bytes > b.second.bytes : a.first < b.first;
+    });
+    if (!nodes.empty()) {
+        os << llvm::format("%-32s %12s %12s\n", (const char *) "AST nodes in the arena (KiB)", (const char *) "objects",
+                           (const char *) "bytes");
+        for (auto &n : nodes)
+            os << llvm::format("  %-30s %12zu %12.1f\n", n.first.c_str(), n.second.objects, KiB(n.second.bytes));
+        os << llvm::format("  %-30s %12zu %12.1f\n", (const char *) "total", arena.objects, KiB(arena.bytes));
+    }
+
+    for (auto &m : m_Modules)
+        os << llvm::format("LLVM module after %s: %zu functions, %zu blocks, %zu instructions, heap %+.1f KiB in %s\n",
+                           m.phase.c_str(), m.functions, m.blocks, m.instructions, KiB(m.heap), m.phase.c_str());
+}
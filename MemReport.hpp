@@ -0,0 +1,69 @@
+#ifndef PJPPROJECT_MEMREPORT_HPP
+#define PJPPROJECT_MEMREPORT_HPP
+
+#include <cstddef>
+#include <map>
+#include <string>
+#include <typeindex>
+#include <vector>
+
+#include <llvm/IR/Module.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include "Arena.hpp"
+
+/*
+ * Collects where the memory of a compilation goes for --mem-report. While one
+ * exists, every global operator new and delete is counted (MemReport.cpp
+ * replaces them), so each driver phase gets its allocation count, the bytes it
+ * allocated, how much the heap grew and its highest point, and the peak RSS so
+ * far. On top of that the parser tells it about the source text, every AST node
+ * made in its arena and the size of the symbol tables.
+ */
+class MemReport : public Arena::Observer {
+public:
+    struct Heap {
+        size_t allocations = 0, allocated = 0, freed = 0;   // counted since the report began
+        long live() const { return (long) (allocated - freed); }
+    };
+
+    MemReport();                      // starts counting
+    ~MemReport() override;            // stops counting
+    static Heap Counters();
+
+    void Phase(const char *name);                             // driver phase that just ended
+    void AddLexing(const Heap &before);                       // allocations of one token since before
+    void Made(const std::type_info &type, size_t size) override;
+    void Component(const char *name, size_t bytes, const char *detail = "");
+    void CountModule(const llvm::Module &module);             // size of the module after the last phase
+    void Print(llvm::raw_ostream &os) const;
+
+private:
+    struct PhaseRow {
+        std::string name;
+        Heap heap;           // counted in this phase alone
+        long live, peak;     // heap held at the end and at most during the phase, since the report began
+        long rss;            // peak RSS of the process so far, in KiB
+    };
+    struct ModuleRow {
+        std::string phase;
+        size_t functions, blocks, instructions;
+        long heap;           // heap change of that phase, mostly the module growing or shrinking
+    };
+    struct Count {
+        size_t objects = 0, bytes = 0;
+    };
+    struct ComponentRow {
+        std::string name, detail;
+        size_t bytes;
+    };
+
+    Heap m_Last;                                  // counters at the end of the previous phase
+    std::vector<PhaseRow> m_Phases;
+    std::vector<ModuleRow> m_Modules;
+    std::vector<ComponentRow> m_Components;
+    Heap m_Lexing;
+    std::map<std::type_index, Count> m_Nodes;     // arena objects by type
+};
+
+#endif //PJPPROJECT_MEMREPORT_HPP
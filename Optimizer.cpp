@@ -0,0 +1,83 @@
+#include "Optimizer.hpp"
+
+#include <cstdio>
+
+#include <llvm/IR/Verifier.h>
+#include <llvm/Passes/PassBuilder.h>
+#include <llvm/Passes/StandardInstrumentations.h>
+#include <llvm/Support/TimeProfiler.h>
+#include <llvm/Transforms/Utils/Mem2Reg.h>
+#include <llvm/Support/raw_ostream.h>
+
+bool ParseOptLevel(const std::string &text, llvm::OptimizationLevel &level) {
+    if (text == "0")
+        level = llvm::OptimizationLevel::O0;
+    else if (text == "1")
+        level = llvm::OptimizationLevel::O1;
+    else if (text == "2")
+        level = llvm::OptimizationLevel::O2;
+    else if (text == "3")
+        level = llvm::OptimizationLevel::O3;
+    else if (text == "s")
+        level = llvm::OptimizationLevel::Os;
+    else if (text == "z")
+        level = llvm::OptimizationLevel::Oz;
+    else
+        return false;
+    return true;
+}
+
+bool OptimizeModule(llvm::Module &module, llvm::TargetMachine *tm, llvm::OptimizationLevel level,
+                    TimeReport *report, const std::string &profileGenerate, const std::string &profileUse) {
+    llvm::TimeTraceScope trace("Optimize");
+    // the passes assume well-formed IR, report generator bugs instead of crashing in them
+    if (llvm::verifyModule(module, &llvm::errs())) {
+        printf("Generated module is broken, not optimizing.\n");
+        return false;
+    }
+
+    llvm::LoopAnalysisManager LAM;
+    llvm::FunctionAnalysisManager FAM;
+    llvm::CGSCCAnalysisManager CGAM;
+    llvm::ModuleAnalysisManager MAM;
+
+    llvm::PipelineTuningOptions PTO;
+    PTO.LoopUnrolling = level.getSpeedupLevel() > 1;
+    PTO.LoopInterleaving = level.getSpeedupLevel() > 1;
+    PTO.LoopVectorization = level.getSpeedupLevel() > 1 && level.getSizeLevel() < 2;
+    PTO.SLPVectorization = level.getSpeedupLevel() > 1 && level.getSizeLevel() < 2;
+
+    // the standard ones honor LLVM's own options (-time-passes, -print-after-all, ...) and the time trace
+    llvm::PassInstrumentationCallbacks PIC;
+    llvm::StandardInstrumentations SI(false);
+    SI.registerCallbacks(PIC, &FAM);
+    if (report)
+        report->Instrument(PIC);
+
+    // instrumentation and profile use run at the same point of the pipeline, so the
+    // profile only matches a module optimized at the level it was generated with
+    llvm::Optional<llvm::PGOOptions> PGO;
+    if (!profileGenerate.empty())
+        PGO = llvm::PGOOptions(profileGenerate, "", "", llvm::PGOOptions::IRInstr);
+    else if (!profileUse.empty())
+        PGO = llvm::PGOOptions(profileUse, "", "", llvm::PGOOptions::IRUse);
+
+    llvm::PassBuilder PB(tm, PTO, PGO, &PIC);
+    PB.registerModuleAnalyses(MAM);
+    PB.registerCGSCCAnalyses(CGAM);
+    PB.registerFunctionAnalyses(FAM);
+    PB.registerLoopAnalyses(LAM);
+    PB.crossRegisterProxies(LAM, FAM, CGAM, MAM);
+
+    llvm::ModulePassManager MPM;
+    if (level == llvm::OptimizationLevel::O0) {
+        // codegen keeps every variable in an entry-block alloca; even unoptimized
+        // builds get them promoted to SSA registers
+        MPM = PB.buildO0DefaultPipeline(level);
+        MPM.addPass(llvm::createModuleToFunctionPassAdaptor(llvm::PromotePass()));
+    } else {
+        MPM = PB.buildPerModuleDefaultPipeline(level);
+    }
+    MPM.run(module, MAM);
+    return true;
+}
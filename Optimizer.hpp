@@ -0,0 +1,28 @@
+#ifndef PJPPROJECT_OPTIMIZER_HPP
+#define PJPPROJECT_OPTIMIZER_HPP
+
+#include <llvm/IR/Module.h>
+#include <llvm/Passes/OptimizationLevel.h>
+#include <llvm/Target/TargetMachine.h>
+
+#include "TimeReport.hpp"
+
+// parses "0", "1", "2", "3", "s" or "z" (the text after -O); returns false on anything else
+bool ParseOptLevel(const std::string &text, llvm::OptimizationLevel &level);
+
+/*
+ * Runs the standard new-pass-manager pipeline for the given level on the module
+ * (mem2reg, inlining, GVN, loop passes, loop and SLP vectorizers, ...).
+ * At -O0 only mem2reg runs. The target machine provides the cost model the
+ * vectorizers and the inliner use. With a report every pass is timed into it.
+ * With profileGenerate the module gets LLVM's profile counters, for a raw
+ * profile written to that file; with profileUse the branch weights and function
+ * entry counts come from that indexed profile (llvm-profdata merge), and the
+ * inliner, block placement and hot/cold splitting follow them.
+ * Returns false, without optimizing, if the module does not verify.
+ */
+bool OptimizeModule(llvm::Module &module, llvm::TargetMachine *tm, llvm::OptimizationLevel level,
+                    TimeReport *report = nullptr, const std::string &profileGenerate = "",
+                    const std::string &profileUse = "");
+
+#endif //PJPPROJECT_OPTIMIZER_HPP
@@ -1,5 +1,12 @@
 #include "Parser.hpp"
 
+#include <unistd.h>
+
+#include <climits>
+
+#include <llvm/IR/Intrinsics.h>
+#include <llvm/Transforms/Utils/ModuleUtils.h>
+
 void CompareError(int s) {
 
     if(s>0)
@@ -7,40 +14,10 @@ void CompareError(int s) {
     else
 
         printf("Error while comparing, expected %d.\n",s);
-    exit(1);
-}
-
-const struct {std::string slovo; Token symb;} keyWordTable[] = {
-        {"begin", tok_begin},
-        {"end", tok_end},
-        {"const", tok_const},
-        {"procedure", tok_procedure},
-        {"forward", tok_forward},
-        {"function", tok_function},
-        {"if", tok_if},
-        {"then", tok_then},
-        {"else", tok_else},
-        {"program", tok_program},
-        {"while", tok_while},
-        {"exit", tok_exit},
-        {"var", tok_var},
-        {"integer", tok_integer},
-        {"for", tok_for},
-        {"do", tok_do},
-        {"or", tok_or},
-        {"mod", tok_mod},
-        {"div", tok_div},
-        {"not", tok_not},
-        {"and", tok_and},
-        {"xor", tok_xor},
-        {"break", tok_break},
-        {"to", tok_to},
-        {"downto", tok_downto},
-        {"", (Token) 0}
-};
+    throw SyntaxError();
+}
 
 std::string skeyWord(int id) {
-    int i = 0;
     if(id>0){
         std::string res="";
         res.push_back((char)id);
@@ -50,17 +27,15 @@ std::string skeyWord(int id) {
         return "identifier";
     if(id==tok_number)
         return "number";
-    while (!keyWordTable[i].slovo.empty())
-        if (id==keyWordTable[i].symb)
-            return keyWordTable[i].slovo;
-        else
-            i++;
+    std::string_view name=keyWordName(id);
+    if(!name.empty())
+        return std::string(name);
     return std::to_string(id);
 }
 void ExpansionError(std::string nonterminal, int s) {
     std::string str=skeyWord(s);
     printf("Error while expanding nonterminal %s, unexpected token %s.\n", nonterminal.c_str(),str.c_str());
-    exit(1);
+    throw SyntaxError();
 }
 
 
@@ -72,40 +47,231 @@ void Parser::Compare(int s) {
 }
 const bool DEBUG=false;
 
-Parser::SymbTable::SymbTable(Parser *p){
-parser=p;
+Parser::SymbTable::SymbTable(Parser *p)
+    : ownBindings(new Bindings)
+    , bindings(ownBindings.get())
+    , parser(p)
+{
+    bindings->Values.resize(p->MilaNames.Size());
+    bindings->Calls.resize(p->MilaNames.Size());
+}
+
+Parser::SymbTable::SymbTable(SymbTable *outer)
+    : bindings(outer->bindings)
+    , contbb(outer->contbb)
+    , ret(outer->ret)
+    , parser(outer->parser)
+{
+}
+
+Parser::SymbTable::~SymbTable(){
+    // by symbol, a later Bind may have moved the stacks
+    for(auto it=pushedValues.rbegin();it!=pushedValues.rend();++it)
+        bindings->Values[*it].pop_back();
+    for(auto it=pushedCalls.rbegin();it!=pushedCalls.rend();++it)
+        bindings->Calls[*it].pop_back();
 }
 
-int Parser::SymbTable::AddConst(std::string name,llvm::Value* value){
-    ConstTable[name]=value;
+Parser::SymbTable Parser::SymbTable::Scope(){
+    return SymbTable(this);
+}
+
+size_t Parser::SymbTable::Bytes() const{
+    size_t bytes=sizeof(Bindings)
+        +bindings->Values.capacity()*sizeof(bindings->Values[0])
+        +bindings->Calls.capacity()*sizeof(bindings->Calls[0]);
+    for(auto &stack:bindings->Values)
+        bytes+=stack.capacity()*sizeof(Entry);
+    for(auto &stack:bindings->Calls)
+        bytes+=stack.capacity()*sizeof(CallEntry);
+    return bytes;
+}
+
+void Parser::SymbTable::Bind(Symbol name,const Entry &entry){
+    if(name>=(Symbol)bindings->Values.size())
+        bindings->Values.resize(name+1);
+    auto &stack=bindings->Values[name];
+    if(!stack.empty() && stack.back().owner==this){
+        stack.back()=entry;
+        return;
+    }
+    stack.push_back(entry);
+    pushedValues.push_back(name);
+}
+
+int Parser::SymbTable::AddConst(Symbol name,llvm::Value* value){
+    Bind(name,{this,ConstEntry,value,false,0,0});
+    return 1;
+}
+int Parser::SymbTable::AddVar(Symbol name,llvm::Value* value){
+    Bind(name,{this,VarEntry,value,false,0,0});
     return 1;
 }
-int Parser::SymbTable::AddVar(std::string name,llvm::Value* value){
-    VarTable[name]=value;
+int Parser::SymbTable::AddArray(Symbol name,llvm::Value* value,int low,int high){
+    Bind(name,{this,ArrayEntry,value,false,low,high});
     return 1;
 }
-int Parser::SymbTable::AddFunc(std::string name,llvm::FunctionCallee value){
-    CallTable[name]=value;
+int Parser::SymbTable::AddCounter(Symbol name,llvm::Value* value){
+    Bind(name,{this,ConstEntry,value,false,0,0});
     return 1;
 }
-llvm::Value *Parser::SymbTable::GetVal(std::string name){
-    if (ConstTable.find(name) != ConstTable.end())
-        return ConstTable[name];
-    if (VarTable.find(name) != VarTable.end()) {
-        auto a= parser->MilaBuilder.CreateLoad(llvm::Type::getInt32Ty(parser->MilaContext),VarTable[name], name.c_str());
-        return a;
+int Parser::SymbTable::AddCounter(Symbol name,llvm::Value* value,int low,int high){
+    Bind(name,{this,ConstEntry,value,true,low,high});
+    return 1;
+}
+int Parser::SymbTable::AddFunc(Symbol name,llvm::FunctionCallee value){
+    if(name>=(Symbol)bindings->Calls.size())
+        bindings->Calls.resize(name+1);
+    auto &stack=bindings->Calls[name];
+    if(!stack.empty() && stack.back().owner==this){
+        stack.back().callee=value;
+        return 1;
+    }
+    stack.push_back({this,value});
+    pushedCalls.push_back(name);
+    return 1;
+}
+llvm::Value *Parser::SymbTable::GetVal(Symbol name){
+    if(name>=(Symbol)bindings->Values.size() || bindings->Values[name].empty())
+        return 0;
+    const Entry &e=bindings->Values[name].back();
+    if(e.kind==ConstEntry)
+        return e.value;
+    if(e.kind!=VarEntry)
+        return 0;
+    return parser->MilaBuilder.CreateLoad(llvm::Type::getInt32Ty(parser->MilaContext),e.value, parser->SymbolName(name));
+}
+llvm::Value *Parser::SymbTable::GetAddr(Symbol name){
+    if(name>=(Symbol)bindings->Values.size() || bindings->Values[name].empty() || bindings->Values[name].back().kind!=VarEntry)
+        return 0;
+    return bindings->Values[name].back().value;
+}
+bool Parser::SymbTable::GetArray(Symbol name,llvm::Value *&value,int &low,int &high){
+    if(name>=(Symbol)bindings->Values.size() || bindings->Values[name].empty() || bindings->Values[name].back().kind!=ArrayEntry)
+        return false;
+    const Entry &e=bindings->Values[name].back();
+    value=e.value;
+    low=e.low;
+    high=e.high;
+    return true;
+}
+bool Parser::SymbTable::GetRange(Symbol name,int &low,int &high){
+    if(name>=(Symbol)bindings->Values.size() || bindings->Values[name].empty())
+        return false;
+    const Entry &e=bindings->Values[name].back();
+    if(e.kind!=ConstEntry)
+        return false;
+    if(e.ranged){
+        low=e.low;
+        high=e.high;
+        return true;
     }
-    return 0;
+    if(auto c=llvm::dyn_cast<llvm::ConstantInt>(e.value)){
+        low=high=c->getSExtValue();
+        return true;
+    }
+    return false;
 }
-llvm::Value *Parser::SymbTable::GetAddr(std::string name){
-    if (VarTable.find(name) != VarTable.end())
-        return VarTable[name];
-    return 0;
+llvm::FunctionCallee Parser::SymbTable::GetCallee(Symbol name){
+    if(name>=(Symbol)bindings->Calls.size() || bindings->Calls[name].empty())
+        return llvm::FunctionCallee(0,0);
+    return bindings->Calls[name].back().callee;
 }
-llvm::FunctionCallee Parser::SymbTable::GetCallee(std::string name){
-    if (CallTable.find(name) != CallTable.end())
-        return CallTable[name];
-    return llvm::FunctionCallee(0,0);
+
+Parser::Folder::Folder(Parser *p)
+    : ownBindings(new std::vector<std::vector<Binding>>)
+    , bindings(ownBindings.get())
+    , parser(p)
+{
+    bindings->resize(p->MilaNames.Size());
+}
+
+Parser::Folder::Folder(Folder *outer)
+    : bindings(outer->bindings)
+    , parser(outer->parser)
+{
+}
+
+Parser::Folder::~Folder(){
+    for(auto it=pushed.rbegin();it!=pushed.rend();++it)
+        (*bindings)[*it].pop_back();
+}
+
+Parser::Folder Parser::Folder::Scope(){
+    return Folder(this);
+}
+
+size_t Parser::Folder::Bytes() const{
+    size_t bytes=bindings->capacity()*sizeof((*bindings)[0]);
+    for(auto &stack:*bindings)
+        bytes+=stack.capacity()*sizeof(Binding);
+    return bytes;
+}
+
+void Parser::Folder::Bind(Symbol name,Binding b){
+    if(name>=(Symbol)bindings->size())
+        bindings->resize(name+1);
+    (*bindings)[name].push_back(b);
+    pushed.push_back(name);
+}
+
+void Parser::Folder::AddConst(Symbol name,int value){
+    Bind(name,{true,value});
+}
+
+void Parser::Folder::AddVar(Symbol name){
+    Bind(name,{false,0});
+}
+
+bool Parser::Folder::GetConst(Symbol name,int &value){
+    if(name>=(Symbol)bindings->size() || (*bindings)[name].empty() || !(*bindings)[name].back().isConst)
+        return false;
+    value=(*bindings)[name].back().value;
+    return true;
+}
+
+Parser::NExpression *Parser::Folder::Number(int value){
+    return parser->m_Arena.Make<NNumberExpression>(value);
+}
+
+void Parser::Folder::FoldBlock(std::vector<NStatement *> &block){
+    std::vector<NStatement *> out;
+    for(int i=block.size()-1;i>=0;--i){
+        size_t first=out.size();
+        block[i]->Fold(*this,out);
+        bool terminated=false;
+        for(size_t j=first;j<out.size();++j)
+            terminated=terminated || out[j]->Terminates();
+        // nothing after exit or break can run
+        if(terminated)
+            break;
+    }
+    block.assign(out.rbegin(),out.rend());
+}
+
+bool Parser::Folder::Evaluate(char operation,int l,int r,int &res){
+    // 32-bit wrap-around, which is also a valid result where the generated add/sub/mul are nsw
+    unsigned ul=l, ur=r;
+    switch(operation){
+        case '+': res=(int)(ul+ur); return true;
+        case '-': res=(int)(ul-ur); return true;
+        case '*': res=(int)(ul*ur); return true;
+        case '%':
+        case 'd':
+            if(r==0 || (r==-1 && l==INT_MIN))
+                return false;
+            res=operation=='%' ? l%r : l/r;
+            return true;
+        case '=': res=l==r; return true;
+        case '!': res=l!=r; return true;
+        case '<': res=l<r; return true;
+        case '>': res=l>r; return true;
+        case '(': res=l<=r; return true;
+        case ')': res=l>=r; return true;
+        case '&': res=l&r; return true;
+        case '|': res=l|r; return true;
+        default: return false;
+    }
 }
 
 int Parser::NProgram::Generate( Parser::SymbTable &SymbTable){
@@ -113,33 +279,28 @@ int Parser::NProgram::Generate( Parser::SymbTable &SymbTable){
     {
         std::vector<llvm::Type*> Ints(1, llvm::Type::getInt32Ty(SymbTable.parser->MilaContext));
         llvm::FunctionType * FT = llvm::FunctionType::get(llvm::Type::getInt32Ty(SymbTable.parser->MilaContext), Ints, false);
-        llvm::Function * F = llvm::Function::Create(FT, llvm::Function::ExternalLinkage, "writeln", SymbTable.parser->MilaModule);
+        llvm::Function * F = llvm::Function::Create(FT, llvm::Function::ExternalLinkage, SymbTable.parser->SymbolName(sym_writeln), SymbTable.parser->MilaModule);
         for (auto & Arg : F->args())
             Arg.setName("x");
+        SymbTable.AddFunc(sym_writeln,llvm::FunctionCallee(FT,F));
     }
     // create write function
     {
         std::vector<llvm::Type*> Ints(1, llvm::Type::getInt32Ty(SymbTable.parser->MilaContext));
         llvm::FunctionType * FT = llvm::FunctionType::get(llvm::Type::getInt32Ty(SymbTable.parser->MilaContext), Ints, false);
-        llvm::Function * F = llvm::Function::Create(FT, llvm::Function::ExternalLinkage, "write", SymbTable.parser->MilaModule);
+        llvm::Function * F = llvm::Function::Create(FT, llvm::Function::ExternalLinkage, SymbTable.parser->SymbolName(sym_write), SymbTable.parser->MilaModule);
         for (auto & Arg : F->args())
             Arg.setName("x");
+        SymbTable.AddFunc(sym_write,llvm::FunctionCallee(FT,F));
     }
     // create readln function
     {
         std::vector<llvm::Type*> Ints(1, llvm::Type::getInt32PtrTy(SymbTable.parser->MilaContext));
         llvm::FunctionType * FT = llvm::FunctionType::get(llvm::Type::getInt32Ty(SymbTable.parser->MilaContext), Ints, false);
-        llvm::Function * F = llvm::Function::Create(FT, llvm::Function::ExternalLinkage, "readln", SymbTable.parser->MilaModule);
-        for (auto & Arg : F->args())
-            Arg.setName("x");
-    }
-    // create dec function
-    {
-        std::vector<llvm::Type*> Ints(1, llvm::Type::getInt32PtrTy(SymbTable.parser->MilaContext));
-        llvm::FunctionType * FT = llvm::FunctionType::get(llvm::Type::getInt32Ty(SymbTable.parser->MilaContext), Ints, false);
-        llvm::Function * F = llvm::Function::Create(FT, llvm::Function::ExternalLinkage, "dec", SymbTable.parser->MilaModule);
+        llvm::Function * F = llvm::Function::Create(FT, llvm::Function::ExternalLinkage, SymbTable.parser->SymbolName(sym_readln), SymbTable.parser->MilaModule);
         for (auto & Arg : F->args())
             Arg.setName("x");
+        SymbTable.AddFunc(sym_readln,llvm::FunctionCallee(FT,F));
     }
 
     for (int i =0;i<decs.size();++i){
@@ -148,6 +309,7 @@ int Parser::NProgram::Generate( Parser::SymbTable &SymbTable){
     }
     // create main function
     {
+        CodegenTimer timer(SymbTable.parser->Report,"main");
         llvm::FunctionType * FT = llvm::FunctionType::get(llvm::Type::getInt32Ty(SymbTable.parser->MilaContext), false);
         llvm::Function * MainFunction = llvm::Function::Create(FT, llvm::Function::ExternalLinkage, "main", SymbTable.parser->MilaModule);
 
@@ -165,7 +327,16 @@ int Parser::NProgram::Generate( Parser::SymbTable &SymbTable){
         }
 
         // return 0
+        SymbTable.parser->MilaBuilder.CreateCall(SymbTable.parser->FlushOutput());
         SymbTable.parser->MilaBuilder.CreateRet(llvm::ConstantInt::get(llvm::Type::getInt32Ty(SymbTable.parser->MilaContext), 0));
+        if(SymbTable.parser->ProfileFunctions){
+            SymbTable.parser->InstrumentFunction(MainFunction);
+            SymbTable.parser->EmitProfileDump(MainFunction);
+        }
+        // at exit, once main has returned and the counters on its way out are complete
+        if(SymbTable.parser->GenerateProfile)
+            llvm::appendToGlobalDtors(SymbTable.parser->MilaModule,
+                                      llvm::cast<llvm::Function>(SymbTable.parser->ProfileWrite().getCallee()),0);
     }
     return 1;
 }
@@ -173,26 +344,204 @@ int Parser::NProgram::Generate( Parser::SymbTable &SymbTable){
 
 
 Parser::Parser()
-    : MilaContext()
+    : Parser(STDIN_FILENO)
+{
+}
+
+Parser::Parser(int fd)
+    : m_Context(new llvm::LLVMContext)
+    , m_Module(new llvm::Module("mila", *m_Context))
+    , MilaContext(*m_Context)
     , MilaBuilder(MilaContext)
-    , MilaModule("mila", MilaContext)
+    , MilaModule(*m_Module)
+    , m_Lexer(fd)
 {
+    // same order as enum Builtin
+    for (const char *name : {"writeln", "write", "readln", "dec", "inc"})
+        MilaNames.Intern(name);
 }
 
 bool Parser::Parse()
 {
-    getNextToken();
-    tree=Start();
+    llvm::TimeTraceScope trace("Parse");
+    if(Memory){
+        m_Arena.SetObserver(Memory);
+        Memory->Component("source text",m_Lexer.bufferBytes(),m_Lexer.isMapped() ? "mapped" : "read into the heap");
+    }
+    if(m_Lexer.readFailed())
+        return false;
+    // errors are printed where they are found, and end only the compilation of this source
+    try{
+        getNextToken();
+        tree=Start();
+    }catch(const SyntaxError &){
+        return false;
+    }
+    if(Memory)
+        Memory->Component("interned names",MilaNames.Bytes(),"approximate");
     return true;
 }
 
-const llvm::Module& Parser::Generate()
+void Parser::Fold()
+{
+    llvm::TimeTraceScope trace("Fold");
+    Parser::Folder f(this);
+    tree->Fold(f);
+    if(Memory)
+        Memory->Component("fold bindings",f.Bytes(),"at most, released after folding");
+}
+
+bool Parser::Generate()
 {
+    llvm::TimeTraceScope trace("Codegen");
     //tree->Write(this);
     Parser::SymbTable st(this);
 
     tree->Generate(st);
-    return this->MilaModule;
+    if(Memory)
+        Memory->Component("symbol table",st.Bytes(),"at most, released after code generation");
+    return m_Errors==0;
+}
+
+llvm::AllocaInst *Parser::CreateEntryAlloca(const llvm::Twine &name,llvm::Type *type)
+{
+    llvm::BasicBlock &entry=MilaBuilder.GetInsertBlock()->getParent()->getEntryBlock();
+    llvm::IRBuilder<> builder(&entry,entry.begin());
+    return builder.CreateAlloca(type ? type : llvm::Type::getInt32Ty(MilaContext),0,name);
+}
+
+llvm::MDNode *Parser::LoopMetadata()
+{
+    // distinct and self-referencing, as the loop passes expect
+    llvm::MDNode *progress=llvm::MDNode::get(MilaContext,llvm::MDString::get(MilaContext,"llvm.loop.mustprogress"));
+    auto self=llvm::MDNode::getTemporary(MilaContext,llvm::None);
+    llvm::MDNode *loop=llvm::MDNode::getDistinct(MilaContext,{self.get(),progress});
+    loop->replaceOperandWith(0,loop);
+    return loop;
+}
+
+llvm::FunctionCallee Parser::FlushOutput()
+{
+    if(llvm::Function *F=MilaModule.getFunction("flushout"))
+        return F;
+    llvm::FunctionType *FT=llvm::FunctionType::get(llvm::Type::getVoidTy(MilaContext),false);
+    return llvm::Function::Create(FT,llvm::Function::ExternalLinkage,"flushout",MilaModule);
+}
+
+llvm::FunctionCallee Parser::ProfileWrite()
+{
+    if(llvm::Function *F=MilaModule.getFunction("profwrite"))
+        return F;
+    llvm::FunctionType *FT=llvm::FunctionType::get(llvm::Type::getVoidTy(MilaContext),false);
+    return llvm::Function::Create(FT,llvm::Function::ExternalLinkage,"profwrite",MilaModule);
+}
+
+/*
+ * --profile: F gets a record of four counters, calls, cycles with its callees,
+ * cycles of its own and calls still running. A recursive call adds to the
+ * cycles with callees only when the outermost call returns, so they are not
+ * counted twice. Every function adds its whole time to mila.profile.children
+ * when it returns, which its caller subtracts from its own cycles. All of it is
+ * plain IR around the entry and each return, so it survives inlining.
+ */
+void Parser::InstrumentFunction(llvm::Function *F)
+{
+    if(!ProfileFunctions)
+        return;
+    llvm::Type *int64=llvm::Type::getInt64Ty(MilaContext);
+    llvm::ArrayType *recordType=llvm::ArrayType::get(int64,4);
+    auto record=new llvm::GlobalVariable(MilaModule,recordType,false,llvm::GlobalValue::InternalLinkage,
+                                         llvm::ConstantAggregateZero::get(recordType),"mila.profile."+F->getName());
+    m_ProfileRecords.emplace_back(record,F->getName().str());
+    // kept rather than looked up by name, a record of a Mila function named children has that name too
+    if(!m_ProfileChildren)
+        m_ProfileChildren=new llvm::GlobalVariable(MilaModule,int64,false,llvm::GlobalValue::InternalLinkage,
+                                                   llvm::ConstantInt::get(int64,0),"mila.profile.children");
+    llvm::GlobalVariable *children=m_ProfileChildren;
+    llvm::Function *clock=llvm::Intrinsic::getDeclaration(&MilaModule,llvm::Intrinsic::readcyclecounter);
+    auto field=[&](llvm::IRBuilder<> &b,unsigned i){return b.CreateConstInBoundsGEP2_32(recordType,record,0,i);};
+    auto add=[&](llvm::IRBuilder<> &b,llvm::Value *ptr,llvm::Value *v){b.CreateStore(b.CreateAdd(b.CreateLoad(int64,ptr),v),ptr);};
+
+    // after the allocas, which mem2reg wants to find first
+    llvm::BasicBlock &entry=F->getEntryBlock();
+    auto at=entry.begin();
+    while(llvm::isa<llvm::AllocaInst>(*at))
+        ++at;
+    llvm::IRBuilder<> b(&entry,at);
+    llvm::Value *start=b.CreateCall(clock,{},"prof.start");
+    llvm::Value *outer=b.CreateLoad(int64,children,"prof.outer");
+    b.CreateStore(llvm::ConstantInt::get(int64,0),children);
+    add(b,field(b,3),llvm::ConstantInt::get(int64,1));
+
+    std::vector<llvm::ReturnInst *> returns;
+    for(auto &BB:*F)
+        if(auto ret=llvm::dyn_cast_or_null<llvm::ReturnInst>(BB.getTerminator()))
+            returns.push_back(ret);
+    for(auto ret:returns){
+        b.SetInsertPoint(ret);
+        llvm::Value *elapsed=b.CreateSub(b.CreateCall(clock,{}),start,"prof.elapsed");
+        llvm::Value *callees=b.CreateLoad(int64,children,"prof.callees");
+        add(b,field(b,0),llvm::ConstantInt::get(int64,1));
+        add(b,field(b,2),b.CreateSub(elapsed,callees));
+        llvm::Value *running=field(b,3);
+        llvm::Value *left=b.CreateSub(b.CreateLoad(int64,running),llvm::ConstantInt::get(int64,1));
+        b.CreateStore(left,running);
+        add(b,field(b,1),b.CreateSelect(b.CreateICmpEQ(left,llvm::ConstantInt::get(int64,0)),elapsed,llvm::ConstantInt::get(int64,0)));
+        b.CreateStore(b.CreateAdd(outer,elapsed),children);
+    }
+}
+
+void Parser::EmitProfileDump(llvm::Function *main)
+{
+    llvm::Type *int8ptr=llvm::Type::getInt8PtrTy(MilaContext);
+    llvm::Type *int64ptr=llvm::Type::getInt64PtrTy(MilaContext);
+    std::vector<llvm::Constant *> records,names;
+    for(auto &r:m_ProfileRecords){
+        records.push_back(llvm::ConstantExpr::getPointerCast(r.first,int64ptr));
+        llvm::Constant *text=llvm::ConstantDataArray::getString(MilaContext,r.second);
+        auto name=new llvm::GlobalVariable(MilaModule,text->getType(),true,llvm::GlobalValue::PrivateLinkage,text,"mila.profile.name");
+        names.push_back(llvm::ConstantExpr::getPointerCast(name,int8ptr));
+    }
+    auto table=[&](llvm::Type *type,std::vector<llvm::Constant *> &items,const char *name){
+        llvm::ArrayType *arrayType=llvm::ArrayType::get(type,items.size());
+        auto array=new llvm::GlobalVariable(MilaModule,arrayType,true,llvm::GlobalValue::PrivateLinkage,
+                                            llvm::ConstantArray::get(arrayType,items),name);
+        return llvm::ConstantExpr::getPointerCast(array,llvm::PointerType::getUnqual(type));
+    };
+    llvm::Constant *recordTable=table(int64ptr,records,"mila.profile.records");
+    llvm::Constant *nameTable=table(int8ptr,names,"mila.profile.names");
+
+    llvm::Type *int32=llvm::Type::getInt32Ty(MilaContext);
+    llvm::FunctionType *FT=llvm::FunctionType::get(llvm::Type::getVoidTy(MilaContext),
+                                                   {int32,llvm::PointerType::getUnqual(int64ptr),llvm::PointerType::getUnqual(int8ptr)},false);
+    llvm::FunctionCallee dump=MilaModule.getOrInsertFunction("profdump",FT);
+    std::vector<llvm::ReturnInst *> returns;
+    for(auto &BB:*main)
+        if(auto ret=llvm::dyn_cast_or_null<llvm::ReturnInst>(BB.getTerminator()))
+            returns.push_back(ret);
+    for(auto ret:returns){
+        llvm::IRBuilder<> b(ret);
+        b.CreateCall(dump,{llvm::ConstantInt::get(int32,records.size()),recordTable,nameTable});
+    }
+}
+
+llvm::FunctionCallee Parser::BoundsError()
+{
+    if(llvm::Function *F=MilaModule.getFunction("boundserror"))
+        return F;
+    llvm::Type *int32=llvm::Type::getInt32Ty(MilaContext);
+    llvm::FunctionType *FT=llvm::FunctionType::get(llvm::Type::getVoidTy(MilaContext),{int32,int32,int32},false);
+    llvm::Function *F=llvm::Function::Create(FT,llvm::Function::ExternalLinkage,"boundserror",MilaModule);
+    F->addFnAttr(llvm::Attribute::NoReturn);
+    F->addFnAttr(llvm::Attribute::Cold);
+    F->addFnAttr(llvm::Attribute::NoUnwind);
+    return F;
+}
+
+std::pair<std::unique_ptr<llvm::LLVMContext>,std::unique_ptr<llvm::Module>> Parser::TakeModule()
+{
+    MilaBuilder.ClearInsertionPoint();
+    return {std::move(m_Context), std::move(m_Module)};
 }
 
 /**
@@ -204,8 +553,16 @@ const llvm::Module& Parser::Generate()
  */
 int Parser::getNextToken()
 {
-
-    return CurTok = m_Lexer.gettok();
+    if(!Report && !Memory)
+        return CurTok = m_Lexer.gettok();
+    auto start=TimeReport::Clock::now();
+    MemReport::Heap before=MemReport::Counters();
+    CurTok = m_Lexer.gettok();
+    if(Report)
+        Report->AddLexing(TimeReport::Clock::now()-start);
+    if(Memory)
+        Memory->AddLexing(before);
+    return CurTok;
 }
 
 
@@ -225,7 +582,7 @@ Parser::NProgram *Parser::Start() {
             b=Block();
             Compare('.');
             // Compare(tok_eof);
-            return new NProgram(pname,d,b);
+            return m_Arena.Make<NProgram>(pname,d,b);
         default:
             ExpansionError("S", CurTok);
             return 0;
@@ -239,7 +596,7 @@ Parser::NProgramName *Parser::Program() {
             if(DEBUG)
                 printf("(2) P -> program ident ;\n");
             Compare(tok_program);
-            pname=new NProgramName(m_Lexer.identifierStr());
+            pname=m_Arena.Make<NProgramName>(std::string(m_Lexer.identifierStr()));
             Compare(tok_identifier);
             Compare(';');
             return pname;
@@ -294,6 +651,7 @@ std::vector<Parser::NExpression *> Parser::Expressionlistopt(){
         case tok_identifier:
         case tok_number:
         case '(':
+        case '-':
             if(DEBUG)
                 printf("Elo->E El\n");
             list.push_back(Expression());
@@ -303,8 +661,9 @@ std::vector<Parser::NExpression *> Parser::Expressionlistopt(){
             return {};
     }
 }
-std::vector<Parser::NStatement *> Parser::StatementPrime(std::string ident){
+std::vector<Parser::NStatement *> Parser::StatementPrime(Symbol ident){
     NExpression *expr;
+    NExpression *left;
     std::vector<NExpression *> list;
     switch (CurTok) {
         case tok_assign:
@@ -313,7 +672,16 @@ std::vector<Parser::NStatement *> Parser::StatementPrime(std::string ident){
             Compare(tok_assign);
             expr=Expression();
             //Compare(';');
-            return {new NAssignment(ident, expr)};
+            return {m_Arena.Make<NAssignment>(ident, expr)};
+        case '[':
+            if(DEBUG)
+                printf("() S' -> [ E ] := E\n");
+            Compare('[');
+            expr=Expression();
+            Compare(']');
+            left=m_Arena.Make<NArrayExpression>(ident, expr);
+            Compare(tok_assign);
+            return {m_Arena.Make<NArrayAssignment>(left, Expression())};
         case '(':
             if(DEBUG)
                 printf("() S' -> ( Elo )\n");
@@ -321,19 +689,19 @@ std::vector<Parser::NStatement *> Parser::StatementPrime(std::string ident){
             list=Expressionlistopt();
             Compare(')');
             //Compare(';');
-            return {new NCallStatement(ident, list)};
+            return {m_Arena.Make<NCallStatement>(ident, list)};
         default:
             ExpansionError("S'", CurTok);
             return {};
     }
 }
 std::vector<Parser::NStatement *> Parser::Statement(){
-    std::string ident;
+    Symbol ident;
     std::vector<NStatement *>res;
     NExpression *a;
     NExpression *a2;
     std::vector<NStatement *>b;
-    std::string varname;
+    Symbol varname;
     char dir;
     std::vector<NStatement *> c={};
     switch (CurTok) {
@@ -344,7 +712,7 @@ std::vector<Parser::NStatement *> Parser::Statement(){
         case tok_identifier:
             if(DEBUG)
                 printf("() S -> ident S'\n");
-            ident=m_Lexer.identifierStr();
+            ident=MilaNames.Intern(m_Lexer.identifierStr());
             Compare(tok_identifier);
             return StatementPrime(ident);
         case tok_exit:
@@ -352,13 +720,13 @@ std::vector<Parser::NStatement *> Parser::Statement(){
                 printf("() S -> exit'\n");
             // Compare(tok_exit);
             CurTok=';';
-            return {new NExit()};
+            return {m_Arena.Make<NExit>()};
         case tok_break:
             if(DEBUG)
                 printf("() S -> break'\n");
             // Compare(tok_exit);
             CurTok=';';
-            return {new NBreak()};
+            return {m_Arena.Make<NBreak>()};
         case tok_if:
             Compare(tok_if);
             a=Expression();
@@ -368,19 +736,19 @@ std::vector<Parser::NStatement *> Parser::Statement(){
                 Compare(tok_else);
                 c=Statement();
             }
-            return {new NCondition(a,b,c)};
+            return {m_Arena.Make<NCondition>(a,b,c)};
         case tok_while:
             Compare(tok_while);
             a=Expression();
             Compare(tok_do);
             b=Statement();
-            return {new NWhile(a,b)};
+            return {m_Arena.Make<NWhile>(a,b)};
         case tok_for:
 
             if(DEBUG)
                 printf("() S -> for ident := E to E do S'\n");
             Compare(tok_for);
-            varname=m_Lexer.identifierStr();
+            varname=MilaNames.Intern(m_Lexer.identifierStr());
             Compare(tok_identifier);
             Compare(tok_assign);
             a=Expression();
@@ -400,7 +768,7 @@ std::vector<Parser::NStatement *> Parser::Statement(){
             a2=Expression();
             Compare(tok_do);
             b=Statement();
-            return {new NFor(dir,varname,a,a2,b)};
+            return {m_Arena.Make<NFor>(dir,varname,a,a2,b)};
 
         default:
             ExpansionError("S", CurTok);
@@ -428,7 +796,9 @@ std::vector<Parser::NStatement *> Parser::StatementList(std::vector<NStatement *
             if(DEBUG)
                 printf("(4.1) L -> S; L\n");
             n=Statement();
-            Compare(';');
+            // the separator before end is optional
+            if(CurTok!=tok_end)
+                Compare(';');
             l.insert(l.begin(),n.begin(),n.end());
             return StatementList(l);
         case ';':
@@ -506,20 +876,20 @@ std::vector<Parser::NDeclaration*>  Parser::Const() {
 }
 
 Parser::NConstDeclaration *Parser::ConstElem() {
-    std::string left;
+    Symbol left;
     int n;
     switch (CurTok) {
         case tok_identifier:
             if(DEBUG)
                 printf("(6.1) Ce -> ident = E;\n");
-            left=m_Lexer.identifierStr();
+            left=MilaNames.Intern(m_Lexer.identifierStr());
             Compare(tok_identifier);
             Compare('=');
             n=m_Lexer.numVal();
             Compare(tok_number);
             //Expression();
             Compare(';');
-            return new NConstDeclaration(left,n);
+            return m_Arena.Make<NConstDeclaration>(left,n);
         default:
             ExpansionError("C", CurTok);
             return 0;
@@ -562,6 +932,46 @@ std::string Parser::Type() {
             return "";
     }
 }
+void Parser::ArrayType(int &low,int &high) {
+    switch (CurTok) {
+        case tok_array:
+            if(DEBUG)
+                printf("T -> array [ B .. B ] of integer\n");
+            Compare(tok_array);
+            Compare('[');
+            low=Bound();
+            Compare('.');
+            Compare('.');
+            high=Bound();
+            Compare(']');
+            Compare(tok_of);
+            Compare(tok_integer);
+            if(high<low || (int64_t)high-low>=INT_MAX){
+                printf("Invalid array bounds %d .. %d.\n",low,high);
+                throw SyntaxError();
+            }
+            return;
+        default:
+            ExpansionError("T", CurTok);
+    }
+}
+int Parser::Bound() {
+    int n;
+    switch (CurTok) {
+        case '-':
+            Compare('-');
+            n=m_Lexer.numVal();
+            Compare(tok_number);
+            return -n;
+        case tok_number:
+            n=m_Lexer.numVal();
+            Compare(tok_number);
+            return n;
+        default:
+            ExpansionError("B", CurTok);
+            return 0;
+    }
+}
 std::vector<Parser::NVarDeclaration*> Parser::Var() {
     std::vector<NVarDeclaration*> res;
     std::vector<NVarDeclaration*> list;
@@ -582,23 +992,30 @@ std::vector<Parser::NVarDeclaration*> Parser::Var() {
 
 std::vector<Parser::NVarDeclaration*> Parser::VarElem() {
     std::vector<NVarDeclaration*> res;
-    std::vector<std::string> ilist={};
-    std::vector<std::string> fident={};
+    std::vector<Symbol> ilist={};
+    std::vector<Symbol> fident={};
     std::string type;
+    int low,high;
     switch (CurTok) {
         case tok_identifier:
             if(DEBUG)
                 printf("(7.1) Ce -> ident VIl : T\n");
-            fident.push_back(m_Lexer.identifierStr());
+            fident.push_back(MilaNames.Intern(m_Lexer.identifierStr()));
             Compare(tok_identifier);
             ilist= VarIdentList();
             Compare(':');
-            type=Type();
+            if(CurTok==tok_array)
+                ArrayType(low,high);
+            else
+                type=Type();
             if(CurTok==';')
                 Compare(';');
             fident.insert(fident.end(),ilist.begin(),ilist.end());
             for(int i =0;i<fident.size();++i){
-                res.push_back(new NVarDeclaration(fident[i],type));
+                if(type.empty())
+                    res.push_back(m_Arena.Make<NVarDeclaration>(fident[i],low,high));
+                else
+                    res.push_back(m_Arena.Make<NVarDeclaration>(fident[i],type));
             }
             return res;
         default:
@@ -617,9 +1034,9 @@ std::vector<Parser::NVarDeclaration*> Parser::VarElemOpt() {
             return {};
     }
 }
-std::vector<std::string> Parser::VarIdentList() {
-    std::vector<std::string> res={};
-    std::vector<std::string> list;
+std::vector<Parser::Symbol> Parser::VarIdentList() {
+    std::vector<Symbol> res={};
+    std::vector<Symbol> list;
     switch (CurTok) {
         case ':':
             if(DEBUG)
@@ -629,7 +1046,7 @@ std::vector<std::string> Parser::VarIdentList() {
             if(DEBUG)
                 printf("(7.2) VIl -> , ident VIl\n");
             Compare(',');
-            res.push_back(m_Lexer.identifierStr());
+            res.push_back(MilaNames.Intern(m_Lexer.identifierStr()));
             Compare(tok_identifier);
             list= VarIdentList();
             res.insert(res.end(),list.begin(),list.end());
@@ -667,7 +1084,7 @@ std::vector<Parser::NVarDeclaration*> Parser::VarList() {
 }
 
 std::vector<Parser::NDeclaration*> Parser::Function() {
-    std::string name;
+    Symbol name;
     std::vector<NVarDeclaration*> args;
     std::string type;
     std::vector<NDeclaration*> decs;
@@ -677,11 +1094,16 @@ std::vector<Parser::NDeclaration*> Parser::Function() {
             if(DEBUG)
                 printf("(8) F -> function ident (Vlist) : type ; D B;\n");
             Compare(tok_function);
-            name=m_Lexer.identifierStr();
+            name=MilaNames.Intern(m_Lexer.identifierStr());
             Compare(tok_identifier);
             Compare('(');
             args=VarElemOpt();
             Compare(')');
+            for(auto arg:args)
+                if(arg->array){
+                    printf("Array %s cannot be passed as an argument.\n",SymbolName(arg->name).str().c_str());
+                    throw SyntaxError();
+                }
             Compare(':');
             type=Type();
             Compare(';');
@@ -689,12 +1111,12 @@ std::vector<Parser::NDeclaration*> Parser::Function() {
                 case tok_forward:
                     Compare(tok_forward);
                     Compare(';');
-                    return {new NFunctionPrototype(name, args, type)};*/
+                    return {m_Arena.Make<NFunctionPrototype>(name, args, type)};*/
                 default:
                     decs=Declarations();
                     block=Block();
                     Compare(';');
-                    return {new NFunctionDeclaration(new NFunctionPrototype(name, args, type), decs, block)};
+                    return {m_Arena.Make<NFunctionDeclaration>(m_Arena.Make<NFunctionPrototype>(name, args, type), decs, block)};
             }
         default:
             ExpansionError("F", CurTok);
@@ -703,7 +1125,7 @@ std::vector<Parser::NDeclaration*> Parser::Function() {
 }
 
 std::vector<Parser::NDeclaration*> Parser::Procedure() {
-    std::string name;
+    Symbol name;
     std::vector<NVarDeclaration*> args;
     std::string type;
     std::vector<NDeclaration*> decs;
@@ -713,16 +1135,21 @@ std::vector<Parser::NDeclaration*> Parser::Procedure() {
             if(DEBUG)
                 printf("(9) P -> procedure ident (Vlist); D B;\n");
             Compare(tok_procedure);
-            name=m_Lexer.identifierStr();
+            name=MilaNames.Intern(m_Lexer.identifierStr());
             Compare(tok_identifier);
             Compare('(');
             args=VarElemOpt();
             Compare(')');
+            for(auto arg:args)
+                if(arg->array){
+                    printf("Array %s cannot be passed as an argument.\n",SymbolName(arg->name).str().c_str());
+                    throw SyntaxError();
+                }
             Compare(';');
             decs=Declarations();
             block=Block();
             Compare(';');
-            return {new NProcedureDeclaration(new NProcedurePrototype(name, args), decs, block)};
+            return {m_Arena.Make<NProcedureDeclaration>(m_Arena.Make<NProcedurePrototype>(name, args), decs, block)};
         default:
             ExpansionError("P", CurTok);
             return {};
@@ -734,6 +1161,7 @@ Parser::NExpression *Parser::Expression(){
         case tok_identifier:
         case tok_number:
         case '(':
+        case '-':
             if(DEBUG)
                 printf(" E -> T E'\n");
             return ExpressionPrime(LogExpression());
@@ -750,13 +1178,14 @@ Parser::NExpression *Parser::ExpressionPrime(NExpression * v){
             if(DEBUG)
                 printf("(2a) E' -> and T E'\n");
             Compare(tok_and);
-            return ExpressionPrime(new NBinaryExpression('&',v,LogExpression()));
+            return ExpressionPrime(m_Arena.Make<NBinaryExpression>('&',v,LogExpression()));
         case tok_or:
             if(DEBUG)
                 printf("(2b) E' -> or T E'\n");
             Compare(tok_or);
-            return ExpressionPrime(new NBinaryExpression('|',v,LogExpression()));
+            return ExpressionPrime(m_Arena.Make<NBinaryExpression>('|',v,LogExpression()));
         case ')':
+        case ']':
         case tok_then:
         case tok_else:
         case tok_do:
@@ -778,6 +1207,7 @@ Parser::NExpression *Parser::LogExpression(){
         case tok_identifier:
         case tok_number:
         case '(':
+        case '-':
             if(DEBUG)
                 printf(" lE -> T lE'\n");
             return LogExpressionPrime(AlgExpression());
@@ -794,38 +1224,39 @@ Parser::NExpression *Parser::LogExpressionPrime(NExpression * v){
             if(DEBUG)
                 printf("(2a) lE' -> mod aE lE'\n");
             Compare(tok_mod);
-            return LogExpressionPrime(new NBinaryExpression('%',v,AlgExpression()));
+            return LogExpressionPrime(m_Arena.Make<NBinaryExpression>('%',v,AlgExpression()));
         case '=':
             if(DEBUG)
                 printf("(2b) lE' -> = aE lE'\n");
             Compare('=');
-            return LogExpressionPrime(new NBinaryExpression('=',v,AlgExpression()));
+            return LogExpressionPrime(m_Arena.Make<NBinaryExpression>('=',v,AlgExpression()));
         case tok_notequal:
             if(DEBUG)
                 printf("(2b) lE' -> != aE lE'\n");
             Compare(tok_notequal);
-            return LogExpressionPrime(new NBinaryExpression('!',v,AlgExpression()));
+            return LogExpressionPrime(m_Arena.Make<NBinaryExpression>('!',v,AlgExpression()));
         case '<':
             if(DEBUG)
                 printf("(2b) lE' -> < aE lE'\n");
             Compare('<');
-            return LogExpressionPrime(new NBinaryExpression('<',v,AlgExpression()));
+            return LogExpressionPrime(m_Arena.Make<NBinaryExpression>('<',v,AlgExpression()));
         case '>':
             if(DEBUG)
                 printf("(2b) lE' -> > aE lE'\n");
             Compare('>');
-            return LogExpressionPrime(new NBinaryExpression('>',v,AlgExpression()));
+            return LogExpressionPrime(m_Arena.Make<NBinaryExpression>('>',v,AlgExpression()));
         case tok_lessequal:
             if(DEBUG)
                 printf("(2b) lE' -> <= aE lE'\n");
             Compare(tok_lessequal);
-            return LogExpressionPrime(new NBinaryExpression('(',v,AlgExpression()));
+            return LogExpressionPrime(m_Arena.Make<NBinaryExpression>('(',v,AlgExpression()));
         case tok_greaterequal:
             if(DEBUG)
                 printf("(2b) lE' -> >= aE lE'\n");
             Compare(tok_greaterequal);
-            return LogExpressionPrime(new NBinaryExpression(')',v,AlgExpression()));
+            return LogExpressionPrime(m_Arena.Make<NBinaryExpression>(')',v,AlgExpression()));
         case ')':
+        case ']':
         case tok_then:
         case tok_else:
         case tok_do:
@@ -850,6 +1281,7 @@ Parser::NExpression *Parser::AlgExpression(){
         case tok_identifier:
         case tok_number:
         case '(':
+        case '-':
             if(DEBUG)
                 printf(" aE -> T aE'\n");
             return AlgExpressionPrime(Term());
@@ -866,13 +1298,14 @@ Parser::NExpression *Parser::AlgExpressionPrime(NExpression * v){
             if(DEBUG)
                 printf("(2a) aE' -> + T aE'\n");
             Compare('+');
-            return ExpressionPrime(new NBinaryExpression('+',v,Term()));
+            return ExpressionPrime(m_Arena.Make<NBinaryExpression>('+',v,Term()));
         case '-':
             if(DEBUG)
                 printf("(2b) aE' -> - T aE'\n");
             Compare('-');
-            return ExpressionPrime(new NBinaryExpression('-',v,Term()));
+            return ExpressionPrime(m_Arena.Make<NBinaryExpression>('-',v,Term()));
         case ')':
+        case ']':
         case ',':
         case ';':
         case tok_then:
@@ -904,6 +1337,7 @@ Parser::NExpression *Parser::Term(){
         case tok_identifier:
         case tok_number:
         case '(':
+        case '-':
             if(DEBUG)
                 printf(" T -> G T'\n");
             return TermPrime(G());
@@ -919,18 +1353,19 @@ Parser::NExpression *Parser::TermPrime(NExpression * v){
             if(DEBUG)
                 printf("(5a) T' -> * G T'\n");
             Compare('*');
-            return TermPrime(new NBinaryExpression('*',v,G()));
+            return TermPrime(m_Arena.Make<NBinaryExpression>('*',v,G()));
         case '/':
             if(DEBUG)
                 printf("(5b) T' -> / G T'\n");
             Compare('/');
-            return TermPrime(new NBinaryExpression('/',v,G()));
+            return TermPrime(m_Arena.Make<NBinaryExpression>('/',v,G()));
         case tok_div:
             if(DEBUG)
                 printf("(5b) T' -> div G T'\n");
             Compare(tok_div);
-            return TermPrime(new NBinaryExpression('d',v,G()));
+            return TermPrime(m_Arena.Make<NBinaryExpression>('d',v,G()));
         case ')':
+        case ']':
         case ',':
         case '+':
         case '-':
@@ -963,6 +1398,7 @@ Parser::NExpression *Parser::G(){
         case tok_identifier:
         case tok_number:
         case '(':
+        case '-':
             if(DEBUG)
                 printf("(9) G -> F G'\n");
             return GPrime(Factor());
@@ -978,11 +1414,12 @@ Parser::NExpression *Parser::GPrime(NExpression * v){
             if(DEBUG)
                 printf("(10) G' -> ^ F G'\n");
             Compare('^');
-            return new NBinaryExpression('^',v,GPrime(Term()));
+            return m_Arena.Make<NBinaryExpression>('^',v,GPrime(Term()));
         case '/':
         case tok_div:
         case '*':
         case ')':
+        case ']':
         case ',':
         case '+':
         case '-':
@@ -1011,17 +1448,17 @@ Parser::NExpression *Parser::GPrime(NExpression * v){
 }
 
 Parser::NExpression *Parser::Factor(){
-    std::string name;
+    Symbol name;
     NExpression *res;
     switch (CurTok) {
         case tok_identifier:
             if(DEBUG)
-                printf("(7a) F -> ident (%s) F'\n", m_Lexer.identifierStr().c_str());
-            name=m_Lexer.identifierStr();
+                printf("(7a) F -> ident (%.*s) F'\n", (int)m_Lexer.identifierStr().size(), m_Lexer.identifierStr().data());
+            name=MilaNames.Intern(m_Lexer.identifierStr());
             Compare(tok_identifier);
             return FactorPrime(name);
         case tok_number:
-            res=new NNumberExpression(m_Lexer.numVal());
+            res=m_Arena.Make<NNumberExpression>(m_Lexer.numVal());
             if(DEBUG)
                 printf("(7b) F -> numb (%d)\n", m_Lexer.numVal());
             Compare(tok_number);
@@ -1033,13 +1470,19 @@ Parser::NExpression *Parser::Factor(){
             res = Expression();
             Compare(')');
             return res;
+        case '-':
+            if(DEBUG)
+                printf("(8b) F -> - F\n");
+            Compare('-');
+            return m_Arena.Make<NBinaryExpression>('-',m_Arena.Make<NNumberExpression>(0),Factor());
         default:
             ExpansionError("F", CurTok);
             return  0;
     }
 }
-Parser::NExpression *Parser::FactorPrime(std::string name){
+Parser::NExpression *Parser::FactorPrime(Symbol name){
     std::vector<NExpression *> list;
+    NExpression *res;
     switch (CurTok) {
         case '(':
             if(DEBUG)
@@ -1047,11 +1490,18 @@ Parser::NExpression *Parser::FactorPrime(std::string name){
             Compare('(');
             list=Expressionlistopt();
             Compare(')');
-            return new NCallExpression(name,list);
+            return m_Arena.Make<NCallExpression>(name,list);
+        case '[':
+            if(DEBUG)
+                printf("F' -> [ E ]\n");
+            Compare('[');
+            res=Expression();
+            Compare(']');
+            return m_Arena.Make<NArrayExpression>(name,res);
         default:
             if(DEBUG)
                 printf("F' -> e\n");
-            return new NVarExpression(name);
+            return m_Arena.Make<NVarExpression>(name);
     }
 
 }
@@ -10,11 +10,20 @@
 #include <llvm/IR/IRBuilder.h>
 #include <llvm/IR/LLVMContext.h>
 #include <llvm/IR/LegacyPassManager.h>
+#include <llvm/IR/MDBuilder.h>
 #include <llvm/IR/Module.h>
 #include <llvm/IR/Type.h>
 #include <llvm/IR/Verifier.h>
 
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Arena.hpp"
+#include "Interner.hpp"
 #include "Lexer.hpp"
+#include "MemReport.hpp"
+#include "TimeReport.hpp"
 
 
 
@@ -22,52 +31,154 @@
 class Parser {
 public:
     Parser();
-    ~Parser(){
-        if(tree)
-            delete tree;
-
-    };
+    explicit Parser(int fd);         // parse the source read from fd instead of standard input
+    ~Parser() = default;
 
     bool Parse();                    // parse
-    const llvm::Module& Generate();  // generate
+    void Fold();                     // fold constants and drop dead code in the parsed tree
+    bool Generate();                 // generate MilaModule, false if an error was printed
+    // hands the generated module and its context over (e.g. to the JIT), the parser must not be used afterwards
+    std::pair<std::unique_ptr<llvm::LLVMContext>,std::unique_ptr<llvm::Module>> TakeModule();
+    size_t SourceLines() const { return m_Lexer.lineCount(); }
 
-    llvm::LLVMContext MilaContext;   // llvm context
+private:
+    std::unique_ptr<llvm::LLVMContext> m_Context;  // owned until TakeModule()
+    std::unique_ptr<llvm::Module> m_Module;
+public:
+    llvm::LLVMContext &MilaContext;  // llvm context
     llvm::IRBuilder<> MilaBuilder;   // llvm builder
-    llvm::Module MilaModule;         // llvm module
+    llvm::Module &MilaModule;        // llvm module
+
+    typedef int Symbol;              // identifier interned in MilaNames
+    // runtime routines, interned first so their symbols are known constants
+    enum Builtin {sym_writeln, sym_write, sym_readln, sym_dec, sym_inc};
+    Interner MilaNames;              // every identifier seen by the parser
+    llvm::StringRef SymbolName(Symbol s) const {
+        std::string_view n=MilaNames.Name(s);
+        return llvm::StringRef(n.data(),n.size());
+    }
+    bool BoundsCheck=false;          // check array indexes at run time unless they provably stay in bounds
+    bool WrapArithmetic=false;       // -fwrapv: + - * wrap around instead of being marked nsw
+    TimeReport *Report=nullptr;      // --time-report: time the lexer and the code generation of each function
+    MemReport *Memory=nullptr;       // --mem-report: count the lexer's allocations, the AST nodes and the symbol tables
+    // stack slot (i32 unless type is given) in the entry block of the current function, so the frame has a fixed size and mem2reg can promote it
+    llvm::AllocaInst *CreateEntryAlloca(const llvm::Twine &name,llvm::Type *type=nullptr);
+    llvm::FunctionCallee BoundsError();  // runtime routine reporting an index out of bounds, declared on first use
+    llvm::FunctionCallee FlushOutput();  // runtime routine writing out buffered output, called before main returns
+    llvm::MDNode *LoopMetadata();        // fresh llvm.loop id for the latch branch of a counted loop
+    bool ProfileFunctions=false;         // --profile: count calls and cycles of every function, dumped when main ends
+    void InstrumentFunction(llvm::Function *F);  // with ProfileFunctions, once the body of F is complete
+    void EmitProfileDump(llvm::Function *main);  // hands every record to the runtime before main returns
+    bool GenerateProfile=false;          // --profile-generate: the counters of LLVM's instrumentation are written at exit
+    llvm::FunctionCallee ProfileWrite(); // runtime routine writing them as a raw profile, a global destructor
 private:
+    std::vector<std::pair<llvm::GlobalVariable *,std::string>> m_ProfileRecords;  // per instrumented function
+    llvm::GlobalVariable *m_ProfileChildren=nullptr;  // cycles of the callees of the running function
+    int m_Errors=0;                  // code generation errors printed so far
 
 
     int getNextToken();
 
     Lexer m_Lexer;                   // lexer is used to read tokens
+    Arena m_Arena;                   // owns every AST node, released together with the parser
     int CurTok;                      // to keep the current token
 
     void Compare(int s);
 
 
 
+    /*
+     * Scoped symbol table. All scopes of one Generate() walk share one binding stack
+     * per interned symbol; a nested scope (Scope()) only remembers which symbols it
+     * bound and pops their stacks again when it goes away. Entering a scope is O(1) and
+     * a lookup is a plain index by symbol, no string is hashed or compared.
+     */
     class SymbTable{
-        std::map<std::string,llvm::Value*> ConstTable;
-        std::map<std::string,llvm::Value*> VarTable;
-        std::map<std::string,llvm::FunctionCallee> CallTable;
+        enum EntryKind {ConstEntry, VarEntry, ArrayEntry};   // ConstEntry binds a value, VarEntry an address
+        struct Entry{
+            const SymbTable *owner;
+            EntryKind kind;
+            llvm::Value *value;
+            bool ranged;      // ConstEntry whose value provably stays in low..high
+            int low, high;    // array bounds for ArrayEntry
+        };
+        struct CallEntry{
+            const SymbTable *owner;
+            llvm::FunctionCallee callee;
+        };
+        struct Bindings{
+            std::vector<std::vector<Entry>> Values;       // indexed by Symbol
+            std::vector<std::vector<CallEntry>> Calls;
+        };
+        std::unique_ptr<Bindings> ownBindings;   // only set in the outermost scope
+        Bindings *bindings;
+        std::vector<Symbol> pushedValues;        // symbols this scope bound, popped when it goes away
+        std::vector<Symbol> pushedCalls;
+        void Bind(Symbol name,const Entry &entry);
+        explicit SymbTable(SymbTable *outer);
     public:
         llvm::BasicBlock *contbb=0;
         llvm::Value *ret=0;
         Parser *parser;
-        int AddConst(std::string name,llvm::Value* value);
-        int AddVar(std::string name,llvm::Value* value);
-        int AddFunc(std::string name,llvm::FunctionCallee value);
-        llvm::Value *GetVal(std::string name);
-        llvm::Value *GetAddr(std::string name);
-        llvm::FunctionCallee GetCallee(std::string name);
+        int AddConst(Symbol name,llvm::Value* value);
+        int AddVar(Symbol name,llvm::Value* value);
+        int AddFunc(Symbol name,llvm::FunctionCallee value);
+        int AddArray(Symbol name,llvm::Value* value,int low,int high);
+        int AddCounter(Symbol name,llvm::Value* value);                   // loop counter bound to its SSA value
+        int AddCounter(Symbol name,llvm::Value* value,int low,int high);  // ... known to stay in low..high
+        llvm::Value *GetVal(Symbol name);
+        llvm::Value *GetAddr(Symbol name);
+        bool GetArray(Symbol name,llvm::Value *&value,int &low,int &high);
+        bool GetRange(Symbol name,int &low,int &high);
+        llvm::FunctionCallee GetCallee(Symbol name);
+        SymbTable Scope();               // nested scope, inherits contbb and ret
+        size_t Bytes() const;            // memory held by the binding stacks of all scopes
         SymbTable(Parser *p);
+        SymbTable(const SymbTable&) = delete;
+        ~SymbTable();
+    };
+
+    class NExpression;
+    class NStatement;
+
+    /*
+     * Environment of the constant folding pass (Fold()): which symbols currently
+     * name a constant and its value. Scopes nest like SymbTable scopes; a variable,
+     * argument or loop counter hides a constant of the same name.
+     */
+    class Folder{
+        struct Binding{
+            bool isConst;
+            int value;
+        };
+        std::unique_ptr<std::vector<std::vector<Binding>>> ownBindings;
+        std::vector<std::vector<Binding>> *bindings;   // indexed by Symbol
+        std::vector<Symbol> pushed;
+        void Bind(Symbol name,Binding b);
+        explicit Folder(Folder *outer);
+    public:
+        Parser *parser;
+        void AddConst(Symbol name,int value);
+        void AddVar(Symbol name);
+        bool GetConst(Symbol name,int &value);
+        NExpression *Number(int value);  // new literal node
+        // folds a statement list (stored last statement first, like all blocks) in place
+        void FoldBlock(std::vector<NStatement *> &block);
+        // evaluates a binary operator the same way NBinaryExpression::Value does, false if it must be left to run time
+        static bool Evaluate(char operation,int l,int r,int &res);
+        Folder Scope();
+        size_t Bytes() const;            // memory held by the binding stacks of all scopes
+        Folder(Parser *p);
+        Folder(const Folder&) = delete;
+        ~Folder();
     };
 
     class ASTNode{
     public:
         virtual int Generate(SymbTable &SymbTable){return 0;}
     };
-    ASTNode *tree;
+    class NProgram;
+    NProgram *tree;
 
 
     class NProgramName : public ASTNode{
@@ -79,17 +190,37 @@ private:
         }
     };
     class NStatement : public ASTNode{
-
+    public:
+        // appends what is left of the statement after folding (nothing, itself or a replacement) to out, in execution order
+        virtual void Fold(Folder &Folder,std::vector<NStatement *> &out){out.push_back(this);}
+        // control never reaches the statement after this one
+        virtual bool Terminates(){return false;}
+        // the statement may store to the scalar variable name
+        virtual bool Assigns(Symbol name){return false;}
+        static bool Assigns(const std::vector<NStatement *> &block,Symbol name){
+            for(auto s:block)
+                if(s->Assigns(name))
+                    return true;
+            return false;
+        }
     };
     class NExpression : public ASTNode{
     public:
         virtual  llvm::Value * Value(SymbTable &SymbTable){return 0;};
+        virtual NExpression *Fold(Folder &Folder){return this;}
+        virtual bool IsConst(int &value){return false;}
+        // address of the storage the expression names, 0 if it is not a variable or array element
+        virtual llvm::Value *Address(SymbTable &SymbTable){return 0;}
+        virtual bool IsVar(Symbol name){return false;}
+        // low..high provably contains every value the expression can have
+        virtual bool Range(SymbTable &SymbTable,int &low,int &high){return false;}
     };
     class NDeclaration : public ASTNode{
     public:
         virtual void PreDeclare(SymbTable &SymbTable){}
         virtual void InDeclare(SymbTable &SymbTable){}
         virtual void GlobDeclare(SymbTable &SymbTable){}
+        virtual void Fold(Folder &Folder){}
     };
     class NProgram : public ASTNode{
         NProgramName* pName;
@@ -97,60 +228,77 @@ private:
         std::vector<NStatement *> block;
     public:
         NProgram(NProgramName *pname,std::vector<NDeclaration*> d,std::vector<NStatement *> b):pName(pname),decs(d),block(b){}
-        ~NProgram(){
+        int Generate( SymbTable &SymbTable) override;
+        void Fold(Folder &Folder){
             for(auto d:decs)
-                delete d;
-            for(auto s:block)
-                delete s;
+                d->Fold(Folder);
+            Folder.FoldBlock(block);
         }
-        int Generate( SymbTable &SymbTable) override;
     };
     class NConstDeclaration : public NDeclaration{
-        std::string name;
+        Symbol name;
         int right;
     public:
-        NConstDeclaration(const std::string &n,int r):name(n),right(r){}
+        NConstDeclaration(Symbol n,int r):name(n),right(r){}
 
         void PreDeclare(SymbTable &SymbTable){
             SymbTable.AddConst(name,llvm::ConstantInt::get(SymbTable.parser->MilaContext, llvm::APInt(32, right)));
         }
         void InDeclare(SymbTable &SymbTable){}
         void GlobDeclare(SymbTable &SymbTable){}
+        void Fold(Folder &Folder){
+            Folder.AddConst(name,right);
+        }
     };
     class NVarDeclaration : public NDeclaration{
     public:
-        std::string name;
+        Symbol name;
         std::string type;
-        NVarDeclaration(const std::string &n,const std::string &t):name(n),type(t){}
+        bool array=false;
+        int low=0,high=0;                // bounds of an array
+        NVarDeclaration(Symbol n,const std::string &t):name(n),type(t){}
+        NVarDeclaration(Symbol n,int l,int h):name(n),type("array"),array(true),low(l),high(h){}
+        llvm::Type *StorageType(Parser *p){
+            if(array)
+                return llvm::ArrayType::get(llvm::Type::getInt32Ty(p->MilaContext),(uint64_t)((int64_t)high-low+1));
+            return llvm::Type::getInt32Ty(p->MilaContext);
+        }
         void PreDeclare(SymbTable &SymbTable){
         }
         void InDeclare(SymbTable &SymbTable){
-            SymbTable.AddVar(name,SymbTable.parser->MilaBuilder.CreateAlloca(llvm::Type::getInt32Ty(SymbTable.parser->MilaContext), 0,name.c_str()));
+            auto ptr=SymbTable.parser->CreateEntryAlloca(SymbTable.parser->SymbolName(name),StorageType(SymbTable.parser));
+            if(array)
+                SymbTable.AddArray(name,ptr,low,high);
+            else
+                SymbTable.AddVar(name,ptr);
         }
         void GlobDeclare(SymbTable &SymbTable){
-            auto ptr=new llvm::GlobalVariable(SymbTable.parser->MilaModule,llvm::Type::getInt32Ty(SymbTable.parser->MilaContext),false,llvm::GlobalValue::CommonLinkage,llvm::ConstantInt::get(SymbTable.parser->MilaContext, llvm::APInt(32, 0)),name.c_str());
-            SymbTable.AddVar(name,ptr);
+            llvm::Type *type=StorageType(SymbTable.parser);
+            auto ptr=new llvm::GlobalVariable(SymbTable.parser->MilaModule,type,false,llvm::GlobalValue::CommonLinkage,llvm::Constant::getNullValue(type),SymbTable.parser->SymbolName(name));
+            if(array)
+                SymbTable.AddArray(name,ptr,low,high);
+            else
+                SymbTable.AddVar(name,ptr);
+        }
+        void Fold(Folder &Folder){
+            Folder.AddVar(name);
         }
     };
     class NFunctionPrototype : public NDeclaration{
     public:
-        std::string name;
+        Symbol name;
         std::vector<NVarDeclaration*> args;
 
         std::string type;
-        NFunctionPrototype(const std::string &n,std::vector<NVarDeclaration*>& a,const std::string& t):name(n),args(a),type(t){}
-        ~NFunctionPrototype(){
-            for(auto a:args)
-                delete a;
-        }
+        NFunctionPrototype(Symbol n,std::vector<NVarDeclaration*>& a,const std::string& t):name(n),args(a),type(t){}
         int Declare(SymbTable &SymbTable){
             std::vector<llvm::Type*> fargs(args.size(),
                                           llvm::Type::getInt32Ty(SymbTable.parser->MilaContext));
             llvm::FunctionType *FT =llvm::FunctionType::get(llvm::Type::getInt32Ty(SymbTable.parser->MilaContext), fargs, false);
-            llvm::Function *F = llvm::Function::Create(FT, llvm::Function::ExternalLinkage, name, SymbTable.parser->MilaModule);
+            llvm::Function *F = llvm::Function::Create(FT, llvm::Function::ExternalLinkage, SymbTable.parser->SymbolName(name), SymbTable.parser->MilaModule);
             unsigned Idx = 0;
             for (auto &Arg : F->args())
-                Arg.setName(args[Idx++]->name);
+                Arg.setName(SymbTable.parser->SymbolName(args[Idx++]->name));
 
             SymbTable.AddFunc(name,llvm::FunctionCallee(FT,F));
             return 1;
@@ -158,25 +306,56 @@ private:
         }
     };
     class NAssignment : public NStatement{
-        std::string left;
+        Symbol left;
         NExpression *right;
     public:
-        NAssignment(const std::string &l,NExpression *r):left(l),right(r){}
-        ~NAssignment(){
-            if(right)
-                delete right;
+        NAssignment(Symbol l,NExpression *r):left(l),right(r){}
+        void Fold(Folder &Folder,std::vector<NStatement *> &out){
+            right=right->Fold(Folder);
+            out.push_back(this);
         }
+        bool Assigns(Symbol name){return left==name;}
         int Generate(SymbTable &SymbTable){
             auto ptr=SymbTable.GetAddr(left);
-            SymbTable.parser->MilaBuilder.CreateStore(right->Value(SymbTable),ptr);
+            if(!ptr){
+                printf("%s is not a variable\n",SymbTable.parser->SymbolName(left).str().c_str());
+                SymbTable.parser->m_Errors++;
+                return 0;
+            }
+            auto val=right->Value(SymbTable);
+            if(!val)
+                return 0;
+            SymbTable.parser->MilaBuilder.CreateStore(val,ptr);
 
             return 1;
         }
     };
+    class NArrayAssignment : public NStatement{
+        NExpression *left;               // array element
+        NExpression *right;
+    public:
+        NArrayAssignment(NExpression *l,NExpression *r):left(l),right(r){}
+        void Fold(Folder &Folder,std::vector<NStatement *> &out){
+            left=left->Fold(Folder);
+            right=right->Fold(Folder);
+            out.push_back(this);
+        }
+        int Generate(SymbTable &SymbTable){
+            auto ptr=left->Address(SymbTable);
+            auto val=right->Value(SymbTable);
+            if(!ptr || !val)
+                return 0;
+            SymbTable.parser->MilaBuilder.CreateStore(val,ptr);
+            return 1;
+        }
+    };
     class NExit:public NStatement{
     public:
+        bool Terminates(){return true;}
         int Generate(SymbTable &SymbTable){
             if(!SymbTable.ret){
+                if(SymbTable.parser->MilaBuilder.GetInsertBlock()->getParent()->getName()=="main")
+                    SymbTable.parser->MilaBuilder.CreateCall(SymbTable.parser->FlushOutput());
                 SymbTable.parser->MilaBuilder.CreateRet(llvm::ConstantInt::get(llvm::Type::getInt32Ty(SymbTable.parser->MilaContext), 0));
             }else {
                 // auto strref =SymbTable.parser->MilaBuilder.GetInsertBlock()->getParent()->getName();
@@ -192,11 +371,19 @@ private:
     };
     class NBreak:public NStatement{
     public:
+        bool Terminates(){return true;}
         int Generate(SymbTable &SymbTable){
-            if(SymbTable.contbb)
-                SymbTable.parser->MilaBuilder.CreateBr(SymbTable.contbb);
-            else
+            if(!SymbTable.contbb){
                 printf("Error in use of break\n");
+                SymbTable.parser->m_Errors++;
+                return 0;
+            }
+            SymbTable.parser->MilaBuilder.CreateBr(SymbTable.contbb);
+            // statements after the break still need a block, an unreachable one
+            llvm::Function *TheFunction = SymbTable.parser->MilaBuilder.GetInsertBlock()->getParent();
+            llvm::BasicBlock *afterbreak =llvm::BasicBlock::Create(SymbTable.parser->MilaContext, "afterbreak");
+            TheFunction->getBasicBlockList().push_back(afterbreak);
+            SymbTable.parser->MilaBuilder.SetInsertPoint(afterbreak);
             return 1;
         }
     };
@@ -206,15 +393,17 @@ private:
         std::vector<NStatement*> block;
     public:
         NFunctionDeclaration(NFunctionPrototype* p,std::vector<NDeclaration*> d, std::vector<NStatement*> b): prototype(p),decs(d),block(b){}
-        ~NFunctionDeclaration(){
-            if(prototype)
-                delete prototype;
+        void Fold(Folder &Folder){
+            auto f=Folder.Scope();
+            f.AddVar(prototype->name);
+            for(auto arg:prototype->args)
+                arg->Fold(f);
             for(auto d:decs)
-                delete d;
-            for(auto s:block)
-                delete s;
+                d->Fold(f);
+            f.FoldBlock(block);
         }
         void PreDeclare(SymbTable &SymbTable){
+            CodegenTimer timer(SymbTable.parser->Report,SymbTable.parser->SymbolName(prototype->name));
             auto curblock =SymbTable.parser->MilaBuilder.GetInsertBlock();
             auto C=SymbTable.GetCallee(prototype->name);
             if(!C.getCallee()) {
@@ -222,13 +411,13 @@ private:
                 C=SymbTable.GetCallee(prototype->name);
             }
             llvm::Function *F=(llvm::Function *)C.getCallee();
-            auto st=SymbTable;
+            auto st=SymbTable.Scope();
             for (int i =0;i<decs.size();++i){
                 decs[i]->PreDeclare(st);
             }
             llvm::BasicBlock *BB = llvm::BasicBlock::Create(SymbTable.parser->MilaContext, "entry", F);
             SymbTable.parser->MilaBuilder.SetInsertPoint(BB);
-            st.AddVar(prototype->name,st.parser->MilaBuilder.CreateAlloca(llvm::Type::getInt32Ty(SymbTable.parser->MilaContext), 0,prototype->name.c_str()));
+            st.AddVar(prototype->name,st.parser->CreateEntryAlloca(SymbTable.parser->SymbolName(prototype->name)));
 
             st.ret=st.GetAddr(prototype->name);
 
@@ -236,7 +425,7 @@ private:
                 arg->InDeclare(st);
             }
             for (auto &Arg : F->args())
-                st.parser->MilaBuilder.CreateStore(&Arg,st.GetAddr(std::string(Arg.getName().begin(),Arg.getName().end())));
+                st.parser->MilaBuilder.CreateStore(&Arg,st.GetAddr(prototype->args[Arg.getArgNo()]->name));
 
             for (int i =0;i<decs.size();++i){
                 decs[i]->InDeclare(st);
@@ -247,6 +436,7 @@ private:
                 //SymbTable.parser->MilaBuilder.SetInsertPoint(BB);
             }
             SymbTable.parser->MilaBuilder.CreateRet(st.GetVal(prototype->name));
+            SymbTable.parser->InstrumentFunction(F);
             SymbTable.parser->MilaBuilder.SetInsertPoint(curblock);
             // return 0
         }
@@ -257,13 +447,9 @@ private:
     };
     class NProcedurePrototype : public NDeclaration{
     public:
-        std::string name;
+        Symbol name;
         std::vector<NVarDeclaration*> args;
-        NProcedurePrototype(const std::string &n,std::vector<NVarDeclaration*>& a):name(n),args(a){}
-        ~NProcedurePrototype(){
-            for(auto a:args)
-                delete a;
-        }
+        NProcedurePrototype(Symbol n,std::vector<NVarDeclaration*>& a):name(n),args(a){}
         void Declare(SymbTable &SymbTable){
             //SymbTable[name]=llvm::ConstantInt::get(SymbTable.parser->MilaContext, llvm::APInt(32, 0));
         }
@@ -275,27 +461,27 @@ private:
 
     public:
         NProcedureDeclaration(NProcedurePrototype* p,std::vector<NDeclaration*> d,  std::vector<NStatement*> b): prototype(p),decs(d),block(b){}
-        ~NProcedureDeclaration(){
-            if(prototype)
-                delete prototype;
+        void Fold(Folder &Folder){
+            auto f=Folder.Scope();
+            for(auto arg:prototype->args)
+                arg->Fold(f);
             for(auto d:decs)
-                delete d;
-            for(auto s:block)
-                delete s;
+                d->Fold(f);
+            f.FoldBlock(block);
         }
         void PreDeclare(SymbTable &SymbTable){
-
+            CodegenTimer timer(SymbTable.parser->Report,SymbTable.parser->SymbolName(prototype->name));
             auto curblock =SymbTable.parser->MilaBuilder.GetInsertBlock();
             std::vector<llvm::Type*> args(prototype->args.size(),
                                           llvm::Type::getInt32Ty(SymbTable.parser->MilaContext));
             llvm::FunctionType *FT =llvm::FunctionType::get(llvm::Type::getInt32Ty(SymbTable.parser->MilaContext), args, false);
-            llvm::Function *F = llvm::Function::Create(FT, llvm::Function::ExternalLinkage, prototype->name, SymbTable.parser->MilaModule);
+            llvm::Function *F = llvm::Function::Create(FT, llvm::Function::ExternalLinkage, SymbTable.parser->SymbolName(prototype->name), SymbTable.parser->MilaModule);
             unsigned Idx = 0;
             for (auto &Arg : F->args())
-                Arg.setName(prototype->args[Idx++]->name);
+                Arg.setName(SymbTable.parser->SymbolName(prototype->args[Idx++]->name));
 
             SymbTable.AddFunc(prototype->name,llvm::FunctionCallee(FT,F));
-            auto st=SymbTable;
+            auto st=SymbTable.Scope();
             for (int i =0;i<decs.size();++i){
                 decs[i]->PreDeclare(st);
             }
@@ -308,7 +494,7 @@ private:
                 arg->InDeclare(st);
             }
             for (auto &Arg : F->args())
-                st.parser->MilaBuilder.CreateStore(&Arg,st.GetAddr(std::string(Arg.getName().begin(),Arg.getName().end())));
+                st.parser->MilaBuilder.CreateStore(&Arg,st.GetAddr(prototype->args[Arg.getArgNo()]->name));
 
             for (int i =0;i<decs.size();++i){
                 decs[i]->InDeclare(st);
@@ -320,6 +506,7 @@ private:
             }
             // return 0
             SymbTable.parser->MilaBuilder.CreateRet(llvm::ConstantInt::get(llvm::Type::getInt32Ty(SymbTable.parser->MilaContext), 0));
+            SymbTable.parser->InstrumentFunction(F);
 
             SymbTable.parser->MilaBuilder.SetInsertPoint(curblock);
         }
@@ -332,32 +519,98 @@ private:
         int Val;
     public:
         NNumberExpression(int val):Val(val){}
+        bool IsConst(int &value){
+            value=Val;
+            return true;
+        }
+        bool Range(SymbTable &SymbTable,int &low,int &high){
+            low=high=Val;
+            return true;
+        }
         llvm::Value *Value( SymbTable &SymbTable){
             return llvm::ConstantInt::get(SymbTable.parser->MilaContext, llvm::APInt(32, Val));
         }
     };
     class NVarExpression : public NExpression{
     public:
-        std::string Val;
-        NVarExpression(std::string val):Val(val){}
+        Symbol Val;
+        NVarExpression(Symbol val):Val(val){}
+        NExpression *Fold(Folder &Folder){
+            int v;
+            if(Folder.GetConst(Val,v))
+                return Folder.Number(v);
+            return this;
+        }
+        llvm::Value *Address(SymbTable &SymbTable){
+            return SymbTable.GetAddr(Val);
+        }
+        bool IsVar(Symbol name){return Val==name;}
+        bool Range(SymbTable &SymbTable,int &low,int &high){
+            return SymbTable.GetRange(Val,low,high);
+        }
         llvm::Value *Value(SymbTable &SymbTable){
             llvm::Value *v=SymbTable.GetVal(Val);
             if(!v){
                 printf("Unknows variable name\n");
+                SymbTable.parser->m_Errors++;
                 return 0;
             }
             return v;
         }
     };
+    class NArrayExpression : public NExpression{
+        Symbol name;
+        NExpression *index;
+    public:
+        NArrayExpression(Symbol n,NExpression *i):name(n),index(i){}
+        NExpression *Fold(Folder &Folder){
+            index=index->Fold(Folder);
+            return this;
+        }
+        llvm::Value *Address(SymbTable &SymbTable){
+            llvm::Value *base;
+            int low,high;
+            if(!SymbTable.GetArray(name,base,low,high)){
+                printf("Unknown array name\n");
+                SymbTable.parser->m_Errors++;
+                return 0;
+            }
+            llvm::Value *idx=index->Value(SymbTable);
+            if(!idx)
+                return 0;
+            auto &Builder=SymbTable.parser->MilaBuilder;
+            auto &Context=SymbTable.parser->MilaContext;
+            llvm::Type *int32=llvm::Type::getInt32Ty(Context);
+            uint64_t length=(int64_t)high-low+1;
+            llvm::Value *offset=Builder.CreateSub(idx,llvm::ConstantInt::get(int32,low,true),"offset");
+            int ilow,ihigh;
+            if(SymbTable.parser->BoundsCheck && !(index->Range(SymbTable,ilow,ihigh) && ilow>=low && ihigh<=high)){
+                // one unsigned compare of the offset catches both bounds
+                llvm::Function *F=Builder.GetInsertBlock()->getParent();
+                llvm::BasicBlock *FailBB=llvm::BasicBlock::Create(Context,"outofbounds",F);
+                llvm::BasicBlock *OkBB=llvm::BasicBlock::Create(Context,"inbounds",F);
+                llvm::Value *inside=Builder.CreateICmpULT(offset,llvm::ConstantInt::get(int32,length),"boundscheck");
+                Builder.CreateCondBr(inside,OkBB,FailBB,llvm::MDBuilder(Context).createBranchWeights(1<<20,1));
+                Builder.SetInsertPoint(FailBB);
+                Builder.CreateCall(SymbTable.parser->BoundsError(),{idx,llvm::ConstantInt::get(int32,low,true),llvm::ConstantInt::get(int32,high,true)});
+                Builder.CreateUnreachable();
+                Builder.SetInsertPoint(OkBB);
+            }
+            llvm::Type *int64=llvm::Type::getInt64Ty(Context);
+            return Builder.CreateInBoundsGEP(llvm::ArrayType::get(int32,length),base,{llvm::ConstantInt::get(int64,0),Builder.CreateSExt(offset,int64)},"element");
+        }
+        llvm::Value *Value(SymbTable &SymbTable){
+            llvm::Value *ptr=Address(SymbTable);
+            if(!ptr)
+                return 0;
+            return SymbTable.parser->MilaBuilder.CreateLoad(llvm::Type::getInt32Ty(SymbTable.parser->MilaContext),ptr,SymbTable.parser->SymbolName(name));
+        }
+    };
     class NUnaryExpression : public NExpression{
         std::string operation;
         NExpression* expr;
     public:
         NUnaryExpression(std::string o, NExpression* e):operation(o),expr(e){}
-        ~NUnaryExpression(){
-            if(expr)
-                delete expr;
-        }
     };
     class NBinaryExpression : public NExpression{
         char operation;
@@ -365,11 +618,26 @@ private:
         NExpression* right;
     public:
         NBinaryExpression(char o, NExpression* e1, NExpression* e2):operation(o),left(e1),right(e2){}
-        ~NBinaryExpression(){
-            if(left)
-                delete left;
-            if(right)
-                delete right;
+        NExpression *Fold(Folder &Folder){
+            left=left->Fold(Folder);
+            right=right->Fold(Folder);
+            int l,r,res;
+            if(left->IsConst(l) && right->IsConst(r) && Folder::Evaluate(operation,l,r,res))
+                return Folder.Number(res);
+            return this;
+        }
+        bool Range(SymbTable &SymbTable,int &low,int &high){
+            int ll,lh,rl,rh;
+            if((operation!='+' && operation!='-') || !left->Range(SymbTable,ll,lh) || !right->Range(SymbTable,rl,rh))
+                return false;
+            // bounds in 64 bits, give up if the 32-bit operation could wrap
+            int64_t lo=operation=='+' ? (int64_t)ll+rl : (int64_t)ll-rh;
+            int64_t hi=operation=='+' ? (int64_t)lh+rh : (int64_t)lh-rl;
+            if(lo<INT32_MIN || hi>INT32_MAX)
+                return false;
+            low=lo;
+            high=hi;
+            return true;
         }
         llvm::Value *Value( SymbTable &SymbTable){
             llvm::Value *L = left->Value(SymbTable);
@@ -378,13 +646,15 @@ private:
             if (!L || !R)
                 return nullptr;
 
+            // integer is signed: overflow is undefined unless -fwrapv asked for wrap-around
+            bool nsw=!SymbTable.parser->WrapArithmetic;
             switch(operation){
                 case '+':
-                    return SymbTable.parser->MilaBuilder.CreateAdd(L, R, "addtmp");
+                    return SymbTable.parser->MilaBuilder.CreateAdd(L, R, "addtmp", false, nsw);
                 case '-':
-                    return SymbTable.parser->MilaBuilder.CreateSub(L, R, "subtmp");
+                    return SymbTable.parser->MilaBuilder.CreateSub(L, R, "subtmp", false, nsw);
                 case '*':
-                    return SymbTable.parser->MilaBuilder.CreateMul(L, R, "multmp");
+                    return SymbTable.parser->MilaBuilder.CreateMul(L, R, "multmp", false, nsw);
                 case '%':
                     return SymbTable.parser->MilaBuilder.CreateSRem(L, R, "multmp");
                 case 'd':
@@ -394,70 +664,110 @@ private:
                 case '!':
                     return SymbTable.parser->MilaBuilder.CreateIntCast(SymbTable.parser->MilaBuilder.CreateICmpNE(L, R,  "tmpneq"),llvm::Type::getInt32Ty(SymbTable.parser->MilaContext),false,"tmpcast");
                 case '<':
-                    return SymbTable.parser->MilaBuilder.CreateIntCast(SymbTable.parser->MilaBuilder.CreateICmpULT(L, R,  "tmplt"),llvm::Type::getInt32Ty(SymbTable.parser->MilaContext),false,"tmpcast");
+                    return SymbTable.parser->MilaBuilder.CreateIntCast(SymbTable.parser->MilaBuilder.CreateICmpSLT(L, R,  "tmplt"),llvm::Type::getInt32Ty(SymbTable.parser->MilaContext),false,"tmpcast");
                 case '>':
-                    return SymbTable.parser->MilaBuilder.CreateIntCast(SymbTable.parser->MilaBuilder.CreateICmpUGT(L, R,  "tmpgt"),llvm::Type::getInt32Ty(SymbTable.parser->MilaContext),false,"tmpcast");
+                    return SymbTable.parser->MilaBuilder.CreateIntCast(SymbTable.parser->MilaBuilder.CreateICmpSGT(L, R,  "tmpgt"),llvm::Type::getInt32Ty(SymbTable.parser->MilaContext),false,"tmpcast");
                 case '(':
-                    return SymbTable.parser->MilaBuilder.CreateIntCast(SymbTable.parser->MilaBuilder.CreateICmpULE(L, R,  "tmple"),llvm::Type::getInt32Ty(SymbTable.parser->MilaContext),false,"tmpcast");
+                    return SymbTable.parser->MilaBuilder.CreateIntCast(SymbTable.parser->MilaBuilder.CreateICmpSLE(L, R,  "tmple"),llvm::Type::getInt32Ty(SymbTable.parser->MilaContext),false,"tmpcast");
                 case ')':
-                    return SymbTable.parser->MilaBuilder.CreateIntCast(SymbTable.parser->MilaBuilder.CreateICmpUGE(L, R,  "tmpge"),llvm::Type::getInt32Ty(SymbTable.parser->MilaContext),false,"tmpcast");
+                    return SymbTable.parser->MilaBuilder.CreateIntCast(SymbTable.parser->MilaBuilder.CreateICmpSGE(L, R,  "tmpge"),llvm::Type::getInt32Ty(SymbTable.parser->MilaContext),false,"tmpcast");
                 case '&':
                     return SymbTable.parser->MilaBuilder.CreateIntCast(SymbTable.parser->MilaBuilder.CreateAnd(L, R,  "tmpge"),llvm::Type::getInt32Ty(SymbTable.parser->MilaContext),false,"tmpcast");
                 case '|':
                     return SymbTable.parser->MilaBuilder.CreateIntCast(SymbTable.parser->MilaBuilder.CreateOr(L, R,  "tmpge"),llvm::Type::getInt32Ty(SymbTable.parser->MilaContext),false,"tmpcast");
                 default:
                     printf("Unknows variable name\n");
+                    SymbTable.parser->m_Errors++;
                     return 0;
             }
         }
     };
     class NCallExpression : public NExpression{
-        std::string callee;
+        Symbol callee;
         std::vector<NExpression *> args;
     public:
-        NCallExpression(const std::string &c, std::vector<NExpression *> &a):callee(c),args(a){}
-        ~NCallExpression(){
-            for(auto a:args)
-                delete a;
+        NCallExpression(Symbol c, std::vector<NExpression *> &a):callee(c),args(a){}
+        NExpression *Fold(Folder &Folder){
+            for(auto &a:args)
+                a=a->Fold(Folder);
+            return this;
         }
         llvm::Value *Value( SymbTable &SymbTable){
             // call writeln with value from lexel
             std::vector<llvm::Value *> argsv;
+            llvm::FunctionCallee F=SymbTable.GetCallee(callee);
+            if(!F.getCallee()){
+                printf("Unknown function %s\n",SymbTable.parser->SymbolName(callee).str().c_str());
+                SymbTable.parser->m_Errors++;
+                return 0;
+            }
 
             for(int i =0;i<args.size();++i){
                 argsv.push_back(args[i]->Value(SymbTable));
                 if (!argsv.back())
                     return 0;
             }
-            return SymbTable.parser->MilaBuilder.CreateCall(SymbTable.parser->MilaModule.getFunction(callee), argsv,"calltmp");
+            return SymbTable.parser->MilaBuilder.CreateCall(F, argsv,"calltmp");
 
         }
     };
 
     class NCallStatement : public NStatement{
-        std::string callee;
+        Symbol callee;
         std::vector<NExpression *> args;
     public:
-        NCallStatement(const std::string &c, std::vector<NExpression *> &a):callee(c),args(a){}
-        ~NCallStatement(){
-            for(auto a:args)
-                delete a;
+        NCallStatement(Symbol c, std::vector<NExpression *> &a):callee(c),args(a){}
+        void Fold(Folder &Folder,std::vector<NStatement *> &out){
+            // readln, dec and inc take their argument by address
+            if(callee!=sym_readln && callee!=sym_dec && callee!=sym_inc)
+                for(auto &a:args)
+                    a=a->Fold(Folder);
+            out.push_back(this);
+        }
+        bool Assigns(Symbol name){
+            return (callee==sym_readln || callee==sym_dec || callee==sym_inc) && args.size()==1 && args[0]->IsVar(name);
         }
         int Generate(SymbTable &SymbTable){
             // call writeln with value from lexel
             std::vector<llvm::Value *> argsv={};
-            if(callee=="readln"||callee=="dec"){
-                SymbTable.parser->MilaBuilder.CreateCall(SymbTable.parser->MilaModule.getFunction(callee), {SymbTable.GetAddr(((NVarExpression *)args[0])->Val)});
+            // the program may declare its own dec or inc, which is then called like any other procedure
+            bool builtin=callee==sym_readln || ((callee==sym_dec||callee==sym_inc) && !SymbTable.GetCallee(callee).getCallee());
+            if(builtin){
+                llvm::Value *ptr=args.size()==1 ? args[0]->Address(SymbTable) : 0;
+                if(!ptr){
+                    printf("%s expects a variable\n",SymbTable.parser->SymbolName(callee).str().c_str());
+                    SymbTable.parser->m_Errors++;
+                    return 0;
+                }
+                if(callee==sym_readln){
+                    SymbTable.parser->MilaBuilder.CreateCall(SymbTable.GetCallee(callee), {ptr});
+                    return 1;
+                }
+                // dec and inc are plain arithmetic on the variable, no call
+                auto &Builder=SymbTable.parser->MilaBuilder;
+                llvm::Type *int32=llvm::Type::getInt32Ty(SymbTable.parser->MilaContext);
+                llvm::Value *v=Builder.CreateLoad(int32,ptr);
+                llvm::Value *one=llvm::ConstantInt::get(int32,1);
+                bool nsw=!SymbTable.parser->WrapArithmetic;
+                v=callee==sym_dec ? Builder.CreateSub(v,one,"dectmp",false,nsw) : Builder.CreateAdd(v,one,"inctmp",false,nsw);
+                Builder.CreateStore(v,ptr);
                 return 1;
             }
+            llvm::FunctionCallee F=SymbTable.GetCallee(callee);
+            if(!F.getCallee()){
+                printf("Unknown procedure %s\n",SymbTable.parser->SymbolName(callee).str().c_str());
+                SymbTable.parser->m_Errors++;
+                return 0;
+            }
             for(int i =0;i<args.size();++i){
                 argsv.push_back(args[i]->Value(SymbTable));
                 if (!argsv.back()) {
                     printf("error with statement call args\n");
+                    SymbTable.parser->m_Errors++;
                     return 0;
                 }
             }
-            SymbTable.parser->MilaBuilder.CreateCall(SymbTable.parser->MilaModule.getFunction(callee), argsv);
+            SymbTable.parser->MilaBuilder.CreateCall(F, argsv);
             return 1;
 
         }
@@ -471,13 +781,22 @@ private:
         std::vector<NStatement *> el;
     public:
         NCondition(NExpression* ex,std::vector<NStatement *> t,std::vector<NStatement *> e):expr(ex),th(t),el(e){}
-        ~NCondition(){
-            if(expr)
-                delete expr;
-            for(auto s:th)
-                delete s;
-            for(auto s:el)
-                delete s;
+        void Fold(Folder &Folder,std::vector<NStatement *> &out){
+            expr=expr->Fold(Folder);
+            int v;
+            if(expr->IsConst(v)){
+                // only the branch that is taken survives, spliced into the enclosing block
+                auto &taken=v?th:el;
+                for(int i=taken.size()-1;i>=0;--i)
+                    taken[i]->Fold(Folder,out);
+                return;
+            }
+            Folder.FoldBlock(th);
+            Folder.FoldBlock(el);
+            out.push_back(this);
+        }
+        bool Assigns(Symbol name){
+            return NStatement::Assigns(th,name) || NStatement::Assigns(el,name);
         }
         int Generate(SymbTable &SymbTable){
             llvm::Value *condv=expr->Value(SymbTable);
@@ -521,11 +840,16 @@ private:
         std::vector<NStatement *> body;
     public:
         NWhile(NExpression* ex,std::vector<NStatement *> b):expr(ex),body(b){}
-        ~NWhile(){
-            if(expr)
-                delete expr;
-            for(auto s:body)
-                delete s;
+        void Fold(Folder &Folder,std::vector<NStatement *> &out){
+            expr=expr->Fold(Folder);
+            int v;
+            if(expr->IsConst(v) && !v)
+                return;
+            Folder.FoldBlock(body);
+            out.push_back(this);
+        }
+        bool Assigns(Symbol name){
+            return NStatement::Assigns(body,name);
         }
         int Generate(SymbTable &SymbTable){
             llvm::Function *TheFunction = SymbTable.parser->MilaBuilder.GetInsertBlock()->getParent();
@@ -534,7 +858,7 @@ private:
             llvm::BasicBlock *LoopBB =
                     llvm::BasicBlock::Create(SymbTable.parser->MilaContext, "bodyloop");
             llvm::BasicBlock *AfterLoopBB = llvm::BasicBlock::Create(SymbTable.parser->MilaContext, "afterloop");
-            auto st=SymbTable;
+            auto st=SymbTable.Scope();
             st.contbb=AfterLoopBB;
             SymbTable.parser->MilaBuilder.CreateBr(CondBB);
             SymbTable.parser->MilaBuilder.SetInsertPoint(CondBB);
@@ -570,72 +894,82 @@ private:
         NExpression* eexpr;
         char direction;
         std::vector<NStatement *> body;
-        std::string varname;
+        Symbol varname;
     public:
-        NFor(char d,const std::string &varn,NExpression* ex1,NExpression* ex2,std::vector<NStatement *> b):varname(varn),direction(d),sexpr(ex1),eexpr(ex2),body(b){}
-        ~NFor(){
-            if(sexpr)
-                delete sexpr;
-            if(eexpr)
-                delete eexpr;
-            for(auto s:body)
-                delete s;
-        }
+        NFor(char d,Symbol varn,NExpression* ex1,NExpression* ex2,std::vector<NStatement *> b):varname(varn),direction(d),sexpr(ex1),eexpr(ex2),body(b){}
+        void Fold(Folder &Folder,std::vector<NStatement *> &out){
+            sexpr=sexpr->Fold(Folder);
+            eexpr=eexpr->Fold(Folder);
+            int s,e;
+            if(sexpr->IsConst(s) && eexpr->IsConst(e) && (direction=='+' ? s>e : s<e))
+                return;
+            auto f=Folder.Scope();
+            f.AddVar(varname);
+            f.FoldBlock(body);
+            out.push_back(this);
+        }
+        bool Assigns(Symbol name){
+            return varname==name || NStatement::Assigns(body,name);
+        }
+        /*
+         * Counted loop: both bounds are evaluated once, a guard skips the loop when
+         * the range is empty, and the counter is a PHI that the latch steps until it
+         * has reached the end value, so it never steps past it and cannot overflow.
+         */
         int Generate(SymbTable &SymbTable){
-            llvm::Function *TheFunction = SymbTable.parser->MilaBuilder.GetInsertBlock()->getParent();
-
-            llvm::BasicBlock *CondBB = llvm::BasicBlock::Create(SymbTable.parser->MilaContext, "condloop",TheFunction);
-            llvm::BasicBlock *LoopBB =
-                    llvm::BasicBlock::Create(SymbTable.parser->MilaContext, "bodyloop");
-            llvm::BasicBlock *AfterLoopBB = llvm::BasicBlock::Create(SymbTable.parser->MilaContext, "afterloop");
-            auto st=SymbTable;
-            st.contbb=AfterLoopBB;
-
-            auto addr=SymbTable.parser->MilaBuilder.CreateAlloca(llvm::Type::getInt32Ty(SymbTable.parser->MilaContext), 0,"fortmp");
-            SymbTable.parser->MilaBuilder.CreateStore(sexpr->Value(SymbTable),addr);
-            st.AddVar(varname,addr);
-
-            SymbTable.parser->MilaBuilder.CreateBr(CondBB);
-            SymbTable.parser->MilaBuilder.SetInsertPoint(CondBB);
-
-            llvm::Value *start=SymbTable.parser->MilaBuilder.CreateLoad(llvm::Type::getInt32Ty(SymbTable.parser->MilaContext),addr, "fortmp2");
-            llvm::Value *end=eexpr->Value(st);
-
-
+            auto &Builder=SymbTable.parser->MilaBuilder;
+            auto &Context=SymbTable.parser->MilaContext;
+            llvm::Type *int32=llvm::Type::getInt32Ty(Context);
+            llvm::Function *TheFunction = Builder.GetInsertBlock()->getParent();
+            bool up=direction=='+';
+
+            llvm::Value *start=sexpr->Value(SymbTable);
+            llvm::Value *end=eexpr->Value(SymbTable);
             if(!start || !end)
                 return 0;
-            llvm::Value * bcondv =0;
 
-            if(direction=='+')
-                bcondv=SymbTable.parser->MilaBuilder.CreateICmpULE(start, end, "forcond");
-            else if(direction=='-')
-                bcondv=SymbTable.parser->MilaBuilder.CreateICmpUGE(start, end, "forcond");
-            SymbTable.parser->MilaBuilder.CreateCondBr(bcondv, LoopBB, AfterLoopBB);
-            CondBB = SymbTable.parser->MilaBuilder.GetInsertBlock();
+            llvm::BasicBlock *PreBB = Builder.GetInsertBlock();
+            llvm::BasicBlock *LoopBB = llvm::BasicBlock::Create(Context, "bodyloop",TheFunction);
+            llvm::BasicBlock *LatchBB = llvm::BasicBlock::Create(Context, "latchloop");
+            llvm::BasicBlock *AfterLoopBB = llvm::BasicBlock::Create(Context, "afterloop");
+            llvm::Value *guard=up ? Builder.CreateICmpSLE(start, end, "forguard") : Builder.CreateICmpSGE(start, end, "forguard");
+            Builder.CreateCondBr(guard, LoopBB, AfterLoopBB);
 
-            TheFunction->getBasicBlockList().push_back(LoopBB);
+            auto st=SymbTable.Scope();
+            st.contbb=AfterLoopBB;
+            Builder.SetInsertPoint(LoopBB);
+            llvm::PHINode *counter=Builder.CreatePHI(int32, 2, SymbTable.parser->SymbolName(varname));
+            counter->addIncoming(start, PreBB);
+            if(NStatement::Assigns(body,varname)){
+                // the body changes its own copy of the counter, the next iteration starts from the PHI again
+                auto addr=SymbTable.parser->CreateEntryAlloca("fortmp");
+                Builder.CreateStore(counter,addr);
+                st.AddVar(varname,addr);
+            }else{
+                // the counter stays between its bounds, array accesses indexed by it need no check
+                int slow,shigh,elow,ehigh;
+                if(sexpr->Range(SymbTable,slow,shigh) && eexpr->Range(SymbTable,elow,ehigh))
+                    st.AddCounter(varname,counter,up ? slow : elow,up ? ehigh : shigh);
+                else
+                    st.AddCounter(varname,counter);
+            }
 
-            SymbTable.parser->MilaBuilder.SetInsertPoint(LoopBB);
             for(int i =body.size()-1;i>=0;--i){
                 body[i]->Generate(st);
             }
-            // bcondv = SymbTable.parser->MilaBuilder.CreateICmpNE(condv, llvm::ConstantInt::get(SymbTable.parser->MilaContext, llvm::APInt(32,0)), "ifcond");
-            //    SymbTable.parser->MilaBuilder.CreateCondBr(bcondv, LoopBB, AfterLoopBB);
-            llvm::Value *v=0;
-            if(direction=='+')
-                v=SymbTable.parser->MilaBuilder.CreateAdd(start, llvm::ConstantInt::get(SymbTable.parser->MilaContext, llvm::APInt(32,1)), "inctmp");
-            else if(direction=='-')
-                v=SymbTable.parser->MilaBuilder.CreateSub(start, llvm::ConstantInt::get(SymbTable.parser->MilaContext, llvm::APInt(32,1)), "dectmp");
+            Builder.CreateBr(LatchBB);
 
-            SymbTable.parser->MilaBuilder.CreateStore(v,addr);
-            SymbTable.parser->MilaBuilder.CreateBr(CondBB);
-            LoopBB = SymbTable.parser->MilaBuilder.GetInsertBlock();
-            TheFunction->getBasicBlockList().push_back(AfterLoopBB);
-            SymbTable.parser->MilaBuilder.SetInsertPoint(AfterLoopBB);
-            //llvm::PHINode *PN = SymbTable.parser->MilaBuilder.CreatePHI(llvm::Type::getInt32Ty(SymbTable.parser->MilaContext), 2, "iftmp");
+            TheFunction->getBasicBlockList().push_back(LatchBB);
+            Builder.SetInsertPoint(LatchBB);
+            llvm::Value *done=Builder.CreateICmpEQ(counter, end, "fordone");
+            llvm::Value *next=up ? Builder.CreateNSWAdd(counter, llvm::ConstantInt::get(int32, 1), "inctmp")
+                                 : Builder.CreateNSWSub(counter, llvm::ConstantInt::get(int32, 1), "dectmp");
+            counter->addIncoming(next, LatchBB);
+            llvm::Instruction *latch=Builder.CreateCondBr(done, AfterLoopBB, LoopBB);
+            latch->setMetadata(llvm::LLVMContext::MD_loop, SymbTable.parser->LoopMetadata());
 
-            //PN->addIncoming(ThenV, ThenBB);
-            //PN->addIncoming(ElseV, ElseBB);
+            TheFunction->getBasicBlockList().push_back(AfterLoopBB);
+            Builder.SetInsertPoint(AfterLoopBB);
             return 1;
         }
     };
@@ -648,7 +982,7 @@ private:
     std::vector<NStatement *> Block() ;
     std::vector<NExpression *> Expressionlist(std::vector<NExpression *> l);
     std::vector<NExpression *> Expressionlistopt();
-    std::vector<NStatement *> StatementPrime(std::string ident);
+    std::vector<NStatement *> StatementPrime(Symbol ident);
     std::vector<NStatement *> Statement();
     std::vector<NStatement *> StatementList(std::vector<NStatement *> l);
     std::vector<NDeclaration*> Declarations() ;
@@ -656,10 +990,12 @@ private:
     NConstDeclaration *ConstElem();
     std::vector<NDeclaration*> ConstList();
     std::string Type();
+    void ArrayType(int &low,int &high);
+    int Bound();
     std::vector<NVarDeclaration*> Var();
     std::vector<NVarDeclaration*> VarElem();
     std::vector<NVarDeclaration*> VarElemOpt();
-    std::vector<std::string> VarIdentList() ;
+    std::vector<Symbol> VarIdentList() ;
     std::vector<NVarDeclaration*> VarList() ;
     std::vector<NDeclaration*> Function();
     std::vector<NDeclaration*> Procedure();
@@ -674,7 +1010,7 @@ private:
     NExpression *G();
     NExpression *GPrime(NExpression * v);
     NExpression *Factor();
-    NExpression *FactorPrime(std::string name);
+    NExpression *FactorPrime(Symbol name);
 
 
 };
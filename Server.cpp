@@ -0,0 +1,155 @@
+#include "Server.hpp"
+
+#include <errno.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+std::string DefaultSocketPath() {
+    if (const char *path = getenv("MILA_SOCKET"))
+        return path;
+    if (const char *dir = getenv("XDG_RUNTIME_DIR"))
+        return std::string(dir) + "/mila.sock";
+    return "/tmp/mila-" + std::to_string(getuid()) + ".sock";
+}
+
+namespace {
+
+bool ReadAll(int fd, char *p, size_t n) {
+    while (n) {
+        ssize_t r = read(fd, p, n);
+        if (r < 0 && errno == EINTR)
+            continue;
+        if (r <= 0)
+            return false;
+        p += r;
+        n -= r;
+    }
+    return true;
+}
+
+// receives the request header along with the client's three standard streams
+bool ReceiveHeader(int conn, ServerRequest &request, int fds[3]) {
+    struct iovec iov = {&request, sizeof(request)};
+    char control[CMSG_SPACE(3 * sizeof(int))];
+    struct msghdr msg = {};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    if (recvmsg(conn, &msg, MSG_CMSG_CLOEXEC) != sizeof(request))
+        return false;
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    if (!cmsg || cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS
+        || cmsg->cmsg_len != CMSG_LEN(3 * sizeof(int)))
+        return false;
+    memcpy(fds, CMSG_DATA(cmsg), 3 * sizeof(int));
+    return true;
+}
+
+int ReportConn = -1;  // connection still waiting for the exit code
+
+// sends the exit code to the client once everything the compiler printed is written out;
+// called when the compilation returns, and by on_exit when it ends by exit() on an error
+void ReportExit(int status, void *) {
+    if (ReportConn < 0)
+        return;
+    fflush(nullptr);  // exit() flushes stdio only after running the on_exit handlers
+    ssize_t sent = write(ReportConn, &status, sizeof(status));
+    (void) sent;  // nothing left to do if the client is gone
+    ReportConn = -1;
+}
+
+// runs in a process of its own for every connection
+void Handle(int conn, int (*compile)(int argc, char *argv[])) {
+    ServerRequest request;
+    int fds[3];
+    if (!ReceiveHeader(conn, request, fds) || request.argc == 0 || request.size > (64u << 20))
+        _exit(1);
+    std::vector<char> payload(request.size);
+    if (!ReadAll(conn, payload.data(), payload.size()) || payload.empty() || payload.back() != 0)
+        _exit(1);
+    std::vector<char *> strings;
+    for (char *p = payload.data(); p < payload.data() + payload.size(); p += strlen(p) + 1)
+        strings.push_back(p);
+    if (strings.size() < 1 + request.argc)
+        _exit(1);
+
+    for (int i = 0; i < 3; ++i) {
+        dup2(fds[i], i);
+        close(fds[i]);
+    }
+    ReportConn = conn;
+    on_exit(ReportExit, nullptr);
+    if (chdir(strings[0]) != 0) {
+        printf("Cannot change to directory %s.\n", strings[0]);
+        exit(1);
+    }
+    clearenv();
+    for (size_t i = 1 + request.argc; i < strings.size(); ++i)
+        putenv(strings[i]);
+    std::vector<char *> argv(strings.begin() + 1, strings.begin() + 1 + request.argc);
+    argv.push_back(nullptr);
+    int status = compile(request.argc, argv.data());
+    ReportExit(status, nullptr);
+    exit(status);
+}
+
+}
+
+int Serve(const std::string &path, int (*compile)(int argc, char *argv[])) {
+    struct sockaddr_un addr = {};
+    addr.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(addr.sun_path)) {
+        printf("Socket path %s is too long.\n", path.c_str());
+        return 1;
+    }
+    strcpy(addr.sun_path, path.c_str());
+
+    int sock = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (sock < 0) {
+        perror("socket");
+        return 1;
+    }
+    unlink(path.c_str());  // left behind by an earlier server
+    mode_t mask = umask(0077);  // only the user may connect
+    int bound = bind(sock, (struct sockaddr *) &addr, sizeof(addr));
+    umask(mask);
+    if (bound != 0 || listen(sock, 64) != 0) {
+        printf("Cannot listen on %s: %s.\n", path.c_str(), strerror(errno));
+        return 1;
+    }
+    signal(SIGCHLD, SIG_IGN);  // finished requests are reaped by the kernel
+    fprintf(stderr, "Serving on %s.\n", path.c_str());
+
+    for (;;) {
+        int conn = accept4(sock, nullptr, nullptr, SOCK_CLOEXEC);
+        if (conn < 0) {
+            if (errno == EINTR || errno == ECONNABORTED)
+                continue;
+            perror("accept");
+            return 1;
+        }
+        struct ucred cred;
+        socklen_t len = sizeof(cred);
+        if (getsockopt(conn, SOL_SOCKET, SO_PEERCRED, &cred, &len) != 0 || cred.uid != getuid()) {
+            close(conn);
+            continue;
+        }
+        fflush(nullptr);
+        pid_t pid = fork();
+        if (pid == 0) {
+            close(sock);
+            signal(SIGCHLD, SIG_DFL);  // the compiler waits for the linker
+            Handle(conn, compile);
+        }
+        close(conn);
+    }
+}
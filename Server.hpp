@@ -0,0 +1,30 @@
+#ifndef PJPPROJECT_SERVER_HPP
+#define PJPPROJECT_SERVER_HPP
+
+#include <string>
+
+/*
+ * Wire format between the compile server and mila-client (Client.c). The client
+ * sends a ServerRequest together with its standard input, output and error as
+ * SCM_RIGHTS, then size bytes: its working directory, argc arguments and the
+ * environment, every string NUL terminated. The server answers with one int,
+ * the exit code; if the compiler crashed the connection just closes.
+ */
+struct ServerRequest {
+    unsigned size;
+    unsigned argc;
+};
+
+// default socket of the user's compile server
+std::string DefaultSocketPath();
+
+/*
+ * Accepts requests on a Unix socket at path until killed. Every request is run
+ * by compile(argc, argv) in a process forked from this one, so LLVM and the
+ * target are initialized only once and exiting on an error ends just that request.
+ * compile runs in the client's directory and environment, on the client's
+ * standard streams. Returns the exit code if the server cannot start.
+ */
+int Serve(const std::string &path, int (*compile)(int argc, char *argv[]));
+
+#endif //PJPPROJECT_SERVER_HPP
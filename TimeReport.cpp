@@ -0,0 +1,132 @@
+#include "TimeReport.hpp"
+
+#include <algorithm>
+
+#include <llvm/Analysis/LazyCallGraph.h>
+#include <llvm/Analysis/LoopInfo.h>
+#include <llvm/Support/Format.h>
+
+namespace {
+
+double Milliseconds(TimeReport::Clock::duration d) {
+    return std::chrono::duration<double, std::milli>(d).count();
+}
+
+// function a pass ran on, empty for passes over the whole module
+std::string PassUnit(llvm::Any IR) {
+    if (llvm::any_isa<const llvm::Function *>(IR))
+        return llvm::any_cast<const llvm::Function *>(IR)->getName().str();
+    if (llvm::any_isa<const llvm::Loop *>(IR))
+        return llvm::any_cast<const llvm::Loop *>(IR)->getHeader()->getParent()->getName().str();
+    // a call graph SCC is one function unless functions call each other recursively
+    if (llvm::any_isa<const llvm::LazyCallGraph::SCC *>(IR)) {
+        const llvm::LazyCallGraph::SCC *C = llvm::any_cast<const llvm::LazyCallGraph::SCC *>(IR);
+        if (C->size() == 1)
+            return C->begin()->getFunction().getName().str();
+    }
+    return std::string();
+}
+
+}
+
+void TimeReport::Phase(const char *name, double ms) {
+    m_Phases.emplace_back(name, ms);
+}
+
+void TimeReport::BeginCodegen(llvm::StringRef function) {
+    m_Codegen.push_back({function.str(), std::string(), Clock::now()});
+}
+
+void TimeReport::EndCodegen() {
+    std::string unit = m_Codegen.back().unit;
+    m_Functions[unit].codegen += Pop(m_Codegen);
+}
+
+double TimeReport::Pop(std::vector<Frame> &stack) {
+    Clock::duration total = Clock::now() - stack.back().start;
+    double own = Milliseconds(total - stack.back().nested);
+    stack.pop_back();
+    if (!stack.empty())
+        stack.back().nested += total;
+    return own;
+}
+
+void TimeReport::Instrument(llvm::PassInstrumentationCallbacks &PIC) {
+    PIC.registerBeforeNonSkippedPassCallback([this](llvm::StringRef pass, llvm::Any IR) {
+        m_Passes.push_back({PassUnit(IR), pass.str(), Clock::now()});
+    });
+    auto after = [this]() {
+        std::string unit = m_Passes.back().unit, pass = m_Passes.back().pass;
+        double ms = Pop(m_Passes);
+        m_PassTimes[pass] += ms;
+        m_Functions[unit].optimize += ms;
+    };
+    PIC.registerAfterPassCallback([after](llvm::StringRef, llvm::Any, const llvm::PreservedAnalyses &) {
+        after();
+    });
+    PIC.registerAfterPassInvalidatedCallback([after](llvm::StringRef, const llvm::PreservedAnalyses &) {
+        after();
+    });
+}
+
+void TimeReport::CountIR(const llvm::Module &module) {
+    for (const llvm::Function &F : module) {
+        if (F.isDeclaration())
+            continue;
+        Cost &cost = m_Functions[F.getName()];
+        cost.blocks = F.size();
+        cost.instructions = F.getInstructionCount();
+    }
+}
+
+void TimeReport::Print(llvm::raw_ostream &os, unsigned top) const {
+    double total = 0;
+    for (auto &phase : m_Phases)
+        total += phase.second;
+    os << "Time report (ms)\n";
+    for (auto &phase : m_Phases) {
+        os << llvm::format("  %-10s %10.3f %6.1f%%\n", phase.first.c_str(), phase.second,
+                           total > 0 ? 100 * phase.second / total : 0.0);
+        if (phase.first == "parse")
+            os << llvm::format("    %-8s %10.3f  of parse\n", (const char *) "lex", Milliseconds(m_Lexing));
+    }
+    os << llvm::format("  %-10s %10.3f\n", (const char *) "total", total);
+
+    std::vector<std::pair<double, llvm::StringRef>> passes;
+    for (auto &p : m_PassTimes)
+        passes.emplace_back(p.second, p.first());
+    std::sort(passes.begin(), passes.end(), [](auto &a, auto &b) { return a.first > b.first; });
+    if (!passes.empty()) {
+        os << "Optimization passes (ms, without the passes they run)\n";
+        for (size_t i = 0; i < passes.size() && i < top; ++i)
+            os << llvm::format("  %10.3f  ", passes[i].first) << passes[i].second << '\n';
+    }
+
+    std::vector<std::pair<double, llvm::StringRef>> functions;
+    for (auto &f : m_Functions)
+        if (!f.first().empty())
+            functions.emplace_back(f.second.codegen + f.second.optimize, f.first());
+    std::sort(functions.begin(), functions.end(), [](auto &a, auto &b) {
+        return a.first != b.first ? a.first > b.first : a.second < b.second;
+    });
+    os << "Functions (ms)     codegen   optimize     blocks  instructions\n";
+    for (size_t i = 0; i < functions.size() && i < top; ++i) {
+        const Cost &cost = m_Functions.find(functions[i].second)->second;
+        os << llvm::format("  %-14s %10.3f %10.3f %10zu %13zu\n", functions[i].second.str().c_str(),
+                           cost.codegen, cost.optimize, cost.blocks, cost.instructions);
+    }
+    auto module = m_Functions.find("");
+    if (module != m_Functions.end())
+        os << llvm::format("  %-14s %10s %10.3f\n", (const char *) "(module)", (const char *) "", module->second.optimize);
+}
+
+CodegenTimer::CodegenTimer(TimeReport *report, llvm::StringRef function)
+    : m_Report(report), m_Trace("Generate", function) {
+    if (m_Report)
+        m_Report->BeginCodegen(function);
+}
+
+CodegenTimer::~CodegenTimer() {
+    if (m_Report)
+        m_Report->EndCodegen();
+}
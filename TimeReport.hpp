@@ -0,0 +1,63 @@
+#ifndef PJPPROJECT_TIMEREPORT_HPP
+#define PJPPROJECT_TIMEREPORT_HPP
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include <llvm/ADT/StringMap.h>
+#include <llvm/IR/Module.h>
+#include <llvm/IR/PassInstrumentation.h>
+#include <llvm/Support/TimeProfiler.h>
+#include <llvm/Support/raw_ostream.h>
+
+/*
+ * Collects where compile time goes for --time-report: the driver's phases, the
+ * time spent in the lexer, every optimization pass, and per Mila function the
+ * time spent generating and optimizing it together with its size in IR.
+ * Nested work is only counted once, by the innermost function or pass.
+ */
+class TimeReport {
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    void Phase(const char *name, double ms);                  // driver phase, in the order they ran
+    void AddLexing(Clock::duration time) { m_Lexing += time; }
+    void BeginCodegen(llvm::StringRef function);              // code generation of one function begins
+    void EndCodegen();
+    void Instrument(llvm::PassInstrumentationCallbacks &PIC); // times every pass run with PIC
+    void CountIR(const llvm::Module &module);                 // sizes of the functions as they are now
+    void Print(llvm::raw_ostream &os, unsigned top = 10) const;
+
+private:
+    struct Frame {
+        std::string unit;                 // function the work is done for
+        std::string pass;                 // empty for code generation
+        Clock::time_point start;
+        Clock::duration nested{};
+    };
+    struct Cost {
+        double codegen = 0, optimize = 0;
+        size_t blocks = 0, instructions = 0;
+    };
+    // ends the innermost frame and returns its time without the frames nested in it, in ms
+    double Pop(std::vector<Frame> &stack);
+
+    std::vector<std::pair<std::string, double>> m_Phases;
+    Clock::duration m_Lexing{};
+    std::vector<Frame> m_Codegen, m_Passes;
+    llvm::StringMap<Cost> m_Functions;
+    llvm::StringMap<double> m_PassTimes;
+};
+
+// times the code generation of one function for report (if any) and the time trace
+class CodegenTimer {
+public:
+    CodegenTimer(TimeReport *report, llvm::StringRef function);
+    ~CodegenTimer();
+private:
+    TimeReport *m_Report;
+    llvm::TimeTraceScope m_Trace;
+};
+
+#endif //PJPPROJECT_TIMEREPORT_HPP
@@ -0,0 +1,235 @@
+#include "Generator.hpp"
+#include "Parser.hpp"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include <llvm/ADT/SmallString.h>
+#include <llvm/Support/FileSystem.h>
+
+/*
+ * mila-bench: throughput of the lexer, the parser and the code generator on
+ * synthetic programs (Generator.hpp), in tokens and lines per second. Besides
+ * the Google Benchmark flags it takes
+ *   --save-baseline=FILE  write the time of every benchmark to FILE
+ *   --baseline=FILE       compare with FILE, exit with 1 if a benchmark got slower
+ *   --tolerance=PCT       how much slower counts as a regression (default 10)
+ * Baselines only mean something on the machine and build they were made with.
+ */
+
+namespace {
+
+struct Source {
+    std::string path;            // the program in a temporary file, the compiler reads files
+    size_t bytes, lines, tokens;
+};
+
+const std::pair<const char *, ProgramShape> Shapes[] = {
+    {"functions", {2000, 4, 8, 100, 2}},
+    {"blocks", {200, 64, 8, 100, 2}},
+    {"chains", {200, 4, 256, 100, 2}},
+    {"consts", {10, 4, 8, 20000, 2}},
+    {"loops", {200, 4, 8, 100, 32}},
+    {"keywords", {10, 4, 8, 100, 2, 5000}},
+};
+
+std::vector<Source> Sources;
+
+int OpenSource(const Source &source) {
+    int fd = open(source.path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        printf("Cannot open %s.\n", source.path.c_str());
+        exit(1);
+    }
+    return fd;
+}
+
+void Prepare() {
+    for (auto &shape : Shapes) {
+        std::string text = GenerateProgram(shape.second);
+        llvm::SmallString<128> path;
+        int fd;
+        if (llvm::sys::fs::createTemporaryFile("mila-bench", "mila", fd, path)) {
+            printf("Cannot create temporary file.\n");
+            exit(1);
+        }
+        bool ok = write(fd, text.data(), text.size()) == (ssize_t) text.size();
+        close(fd);
+        if (!ok) {
+            printf("Cannot write %s.\n", path.c_str());
+            exit(1);
+        }
+        Source source{std::string(path.str()), text.size(), (size_t) std::count(text.begin(), text.end(), '\n'), 0};
+        fd = OpenSource(source);
+        Lexer lexer(fd);
+        close(fd);
+        while (lexer.gettok() != tok_eof)
+            ++source.tokens;
+        Sources.push_back(source);
+    }
+}
+
+void RemoveSources() {
+    for (auto &source : Sources)
+        llvm::sys::fs::remove(source.path);
+}
+
+void SetRates(benchmark::State &state, const Source &source) {
+    state.counters["tokens/s"] = benchmark::Counter(source.tokens, benchmark::Counter::kIsIterationInvariantRate);
+    state.counters["lines/s"] = benchmark::Counter(source.lines, benchmark::Counter::kIsIterationInvariantRate);
+    state.SetBytesProcessed(state.iterations() * source.bytes);
+}
+
+void Lex(benchmark::State &state, const Source &source) {
+    for (auto _ : state) {
+        int fd = OpenSource(source);
+        Lexer lexer(fd);
+        close(fd);
+        while (lexer.gettok() != tok_eof) {
+        }
+    }
+    SetRates(state, source);
+}
+
+void Parse(benchmark::State &state, const Source &source) {
+    for (auto _ : state) {
+        state.PauseTiming();
+        int fd = OpenSource(source);
+        auto parser = std::make_unique<Parser>(fd);
+        close(fd);
+        state.ResumeTiming();
+        parser->Parse();
+        state.PauseTiming();
+        parser.reset();
+        state.ResumeTiming();
+    }
+    SetRates(state, source);
+}
+
+void Generate(benchmark::State &state, const Source &source) {
+    for (auto _ : state) {
+        state.PauseTiming();
+        int fd = OpenSource(source);
+        auto parser = std::make_unique<Parser>(fd);
+        close(fd);
+        parser->Parse();
+        parser->Fold();
+        state.ResumeTiming();
+        parser->Generate();
+        state.PauseTiming();
+        parser.reset();
+        state.ResumeTiming();
+    }
+    SetRates(state, source);
+}
+
+// keeps the fastest time per iteration of every benchmark, over all repetitions
+class BaselineReporter : public benchmark::ConsoleReporter {
+public:
+    std::map<std::string, double> Seconds;
+
+    void ReportRuns(const std::vector<Run> &runs) override {
+        for (auto &run : runs) {
+            if (run.run_type != Run::RT_Iteration || run.error_occurred || run.iterations == 0)
+                continue;
+            double seconds = run.real_accumulated_time / run.iterations;
+            auto it = Seconds.find(run.run_name.str());
+            if (it == Seconds.end())
+                Seconds[run.run_name.str()] = seconds;
+            else
+                it->second = std::min(it->second, seconds);
+        }
+        ConsoleReporter::ReportRuns(runs);
+    }
+};
+
+bool SaveBaseline(const std::string &path, const std::map<std::string, double> &seconds) {
+    FILE *f = fopen(path.c_str(), "w");
+    if (!f) {
+        printf("Cannot write %s.\n", path.c_str());
+        return false;
+    }
+    fprintf(f, "# mila-bench baseline: benchmark and seconds per iteration\n");
+    for (auto &s : seconds)
+        fprintf(f, "%s %.9g\n", s.first.c_str(), s.second);
+    fclose(f);
+    return true;
+}
+
+// prints every benchmark found in both, false if any got slower than the tolerance allows
+bool CompareBaseline(const std::string &path, const std::map<std::string, double> &seconds, double tolerance) {
+    FILE *f = fopen(path.c_str(), "r");
+    if (!f) {
+        printf("Cannot open %s.\n", path.c_str());
+        return false;
+    }
+    bool ok = true;
+    char line[512], name[256];
+    double before;
+    printf("%-24s %12s %12s %8s\n", "benchmark", "baseline ms", "now ms", "change");
+    while (fgets(line, sizeof(line), f)) {
+        if (line[0] == '#' || sscanf(line, "%255s %lf", name, &before) != 2)
+            continue;
+        auto it = seconds.find(name);
+        if (it == seconds.end())
+            continue;
+        double change = 100 * (it->second - before) / before;
+        bool regressed = change > tolerance;
+        ok = ok && !regressed;
+        printf("%-24s %12.3f %12.3f %+7.1f%%%s\n", name, before * 1e3, it->second * 1e3, change,
+               regressed ? "  regression" : "");
+    }
+    fclose(f);
+    return ok;
+}
+
+}
+
+int main(int argc, char *argv[]) {
+    std::string baseline, save;
+    double tolerance = 10;
+    std::vector<char *> args;
+    for (int i = 0; i < argc; ++i) {
+        if (strncmp(argv[i], "--baseline=", 11) == 0)
+            baseline = argv[i] + 11;
+        else if (strncmp(argv[i], "--save-baseline=", 16) == 0)
+            save = argv[i] + 16;
+        else if (strncmp(argv[i], "--tolerance=", 12) == 0)
+            tolerance = atof(argv[i] + 12);
+        else
+            args.push_back(argv[i]);
+    }
+    int count = args.size();
+    benchmark::Initialize(&count, args.data());
+    if (benchmark::ReportUnrecognizedArguments(count, args.data()))
+        return 1;
+
+    Prepare();
+    for (size_t i = 0; i < Sources.size(); ++i) {
+        std::string shape = Shapes[i].first;
+        const Source &source = Sources[i];
+        benchmark::RegisterBenchmark(("lex/" + shape).c_str(), Lex, source)->Unit(benchmark::kMillisecond);
+        benchmark::RegisterBenchmark(("parse/" + shape).c_str(), Parse, source)->Unit(benchmark::kMillisecond);
+        benchmark::RegisterBenchmark(("generate/" + shape).c_str(), Generate, source)->Unit(benchmark::kMillisecond);
+    }
+    BaselineReporter reporter;
+    benchmark::RunSpecifiedBenchmarks(&reporter);
+    benchmark::Shutdown();
+    RemoveSources();
+
+    if (!save.empty() && !SaveBaseline(save, reporter.Seconds))
+        return 1;
+    if (!baseline.empty() && !CompareBaseline(baseline, reporter.Seconds, tolerance))
+        return 1;
+    return 0;
+}
@@ -0,0 +1,40 @@
+#include "Generator.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+/*
+ * mila-gen: writes a synthetic Mila program to standard output, for example
+ *   mila-gen --functions=5000 --chain=64 > big.mila
+ */
+int main(int argc, char *argv[]) {
+    ProgramShape shape;
+    static const struct {
+        const char *name;
+        unsigned ProgramShape::*field;
+    } options[] = {
+        {"--functions=", &ProgramShape::functions},
+        {"--depth=", &ProgramShape::blockDepth},
+        {"--chain=", &ProgramShape::chainLength},
+        {"--consts=", &ProgramShape::constants},
+        {"--loops=", &ProgramShape::loopDepth},
+        {"--idents=", &ProgramShape::identifiers},
+    };
+    for (int i = 1; i < argc; ++i) {
+        bool known = false;
+        for (auto &o : options) {
+            size_t len = strlen(o.name);
+            if (strncmp(argv[i], o.name, len) == 0) {
+                shape.*o.field = strtoul(argv[i] + len, nullptr, 10);
+                known = true;
+            }
+        }
+        if (!known) {
+            printf("Usage: %s [--functions=N] [--depth=N] [--chain=N] [--consts=N] [--loops=N] [--idents=N]\n", argv[0]);
+            return 1;
+        }
+    }
+    fputs(GenerateProgram(shape).c_str(), stdout);
+    return 0;
+}
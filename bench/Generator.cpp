@@ -0,0 +1,105 @@
+#include "Generator.hpp"
+
+namespace {
+
+// left nested, since the parser does not take a+b+c without parentheses
+std::string Chain(unsigned length, const std::string &first, const char *const operands[], unsigned count) {
+    static const char *const ops[] = {"+", "-", "*", "div", "+", "-"};
+    std::string expr = first;
+    for (unsigned i = 0; i < length; ++i) {
+        const char *op = ops[i % 6];
+        std::string operand = operands[i % count];
+        if (op[0] == 'd')
+            operand = std::to_string(i % 5 + 2);  // never divides by zero
+        expr = "(" + expr + " " + op + " " + operand + ")";
+    }
+    return expr;
+}
+
+void Function(std::string &out, unsigned n, const ProgramShape &shape) {
+    static const char *const operands[] = {"a", "b", "3", "y", "7", "x"};
+    std::string name = "f" + std::to_string(n);
+    out += "function " + name + "(a: integer; b: integer): integer;\n";
+    out += "var x, y";
+    for (unsigned i = 0; i < shape.loopDepth; ++i)
+        out += ", i" + std::to_string(i);
+    out += " : integer;\nbegin\n  x := a;\n  y := b;\n";
+
+    std::string indent = "  ";
+    for (unsigned d = 0; d < shape.blockDepth; ++d) {
+        out += indent + "begin\n";
+        indent += "  ";
+    }
+    out += indent + "x := " + Chain(shape.chainLength, "x", operands, 6) + ";\n";
+    out += indent + "if x > y then y := y + " + std::to_string(n % 9 + 1) + " else y := y - 1;\n";
+    for (unsigned d = 0; d < shape.blockDepth; ++d) {
+        indent.resize(indent.size() - 2);
+        out += indent + "end;\n";
+    }
+
+    for (unsigned i = 0; i < shape.loopDepth; ++i) {
+        out += indent + "for i" + std::to_string(i) + " := 0 to " + std::to_string(i % 3 + 2) + " do\n";
+        indent += "  ";
+    }
+    if (shape.loopDepth) {
+        static const char *const counters[] = {"i0", "a", "1", "b"};
+        out += indent + "y := (y + (" + Chain(shape.chainLength / 2, "x", counters, 4) + " mod 13));\n";
+    }
+    out += "  " + name + " := (x + y);\nend;\n\n";
+}
+
+/*
+ * n-th name with the first and last letter and the length of a long keyword
+ * but other letters in between, e.g. bagin or prxcedure. The lexer's keyword
+ * hash puts them in the keyword's slot, so each one costs a full comparison.
+ */
+std::string KeywordLookalike(unsigned n) {
+    static const char *const keywords[] = {"begin", "const", "procedure", "forward", "function", "program",
+                                           "while", "integer", "break", "downto", "array"};
+    static const unsigned count = sizeof(keywords) / sizeof(keywords[0]);
+    std::string name = keywords[n % count];
+    // the inner letters count up from aaa..., skipping the keyword itself; once
+    // they run out a number is appended, which keeps the names apart but no longer collides
+    unsigned v = n / count, self = 0, weight = 1;
+    for (size_t i = 1; i + 1 < name.size(); ++i, weight *= 26)
+        self += (name[i] - 'a') * weight;
+    unsigned round = v / (weight - 1);
+    v %= weight - 1;
+    if (v >= self)
+        ++v;
+    for (size_t i = 1; i + 1 < name.size(); ++i, v /= 26)
+        name[i] = (char) ('a' + v % 26);
+    return round ? name + std::to_string(round) : name;
+}
+
+}
+
+std::string GenerateProgram(const ProgramShape &shape) {
+    std::string out = "program generated;\n\n";
+    if (shape.constants) {
+        out += "const";
+        for (unsigned i = 0; i < shape.constants; ++i)
+            out += (i ? "      K" : " K") + std::to_string(i) + " = " + std::to_string(i * 7 % 1000) + ";\n";
+        out += "\n";
+    }
+    for (unsigned n = 0; n < shape.functions; ++n)
+        Function(out, n, shape);
+    if (shape.identifiers) {
+        out += "var";
+        for (unsigned i = 0; i < shape.identifiers; ++i)
+            out += (i ? (i % 8 ? ", " : ",\n    ") : " ") + KeywordLookalike(i);
+        out += " : integer;\n\n";
+    }
+
+    out += "begin\n";
+    for (unsigned i = 0; i < shape.identifiers; ++i) {
+        std::string name = KeywordLookalike(i);
+        out += "  if " + name + " > 3 then " + name + " := " + name + " - 1 else " + name + " := " + name + " + 2;\n";
+    }
+    for (unsigned n = 0; n < shape.functions; n += 10) {
+        std::string a = shape.constants ? "K" + std::to_string(n % shape.constants) : std::to_string(n);
+        out += "  writeln(f" + std::to_string(n) + "(" + a + ", " + std::to_string(n % 17) + "));\n";
+    }
+    out += "  writeln(0);\nend.\n";
+    return out;
+}
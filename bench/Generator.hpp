@@ -0,0 +1,25 @@
+#ifndef PJPPROJECT_GENERATOR_HPP
+#define PJPPROJECT_GENERATOR_HPP
+
+#include <string>
+
+/*
+ * Shape of a synthetic Mila program. Every dimension stresses another part of
+ * the front end: many functions the symbol tables and the module, nested blocks
+ * and loops the recursion of the parser, long operator chains the expression
+ * parser and the code generated for it, a huge const section the interner,
+ * many names that look like keywords the lexer's keyword lookup.
+ */
+struct ProgramShape {
+    unsigned functions = 1000;   // functions in the program, main calls every tenth
+    unsigned blockDepth = 4;     // begin/end blocks nested in every function
+    unsigned chainLength = 8;    // operators in every expression
+    unsigned constants = 100;    // names in the program's const section
+    unsigned loopDepth = 2;      // for loops nested in every function
+    unsigned identifiers = 0;    // variables of main spelled like keywords, each used in an if statement
+};
+
+// a valid program of that shape, the same for the same shape
+std::string GenerateProgram(const ProgramShape &shape);
+
+#endif //PJPPROJECT_GENERATOR_HPP
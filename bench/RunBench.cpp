@@ -0,0 +1,267 @@
+#include <fcntl.h>
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+/*
+ * mila-runbench: how fast compiled Mila programs run. Every program in
+ * bench/runtime is compiled at -O0 to -O3 and its C twin with the C compiler at
+ * -O2, the speed the Mila version could reach. Each is run a few times on the
+ * same input; the table shows the best wall time, the instructions retired
+ * (when perf events are available) and the time relative to C. Outputs must
+ * match the C program's, otherwise the run fails.
+ *
+ *   mila-runbench [--mila=PATH] [--cc=PATH] [--scale=F] [--runs=N] [program...]
+ *
+ * --scale multiplies the work of every program, with the input adjusted to how
+ * its run time grows (n, n squared, or the Fibonacci recursion).
+ */
+
+namespace {
+
+enum class Growth {Linear, Quadratic, Fibonacci};
+
+struct Program {
+    const char *name;
+    long size;          // input at --scale=1
+    Growth growth;
+    long limit;         // largest input the program takes, 0 if any
+};
+
+const Program Programs[] = {
+    {"factorization", 500000, Growth::Linear, 0},
+    {"isprime", 3000000, Growth::Linear, 0},
+    {"gcd", 1500, Growth::Quadratic, 0},
+    {"fibonacci", 33, Growth::Fibonacci, 45},    // fib(46) does not fit an integer
+    {"factorialRec", 10000000, Growth::Linear, 0},
+    {"sortBubble", 6000, Growth::Quadratic, 10000},
+};
+
+long Input(const Program &p, double scale) {
+    long n = p.size;
+    switch (p.growth) {
+        case Growth::Linear:
+            n = std::lround(p.size * scale);
+            break;
+        case Growth::Quadratic:
+            n = std::lround(p.size * std::sqrt(scale));
+            break;
+        case Growth::Fibonacci:
+            // every step up costs the golden ratio more
+            n = p.size + std::lround(std::log(scale) / std::log(1.618034));
+            break;
+    }
+    return p.limit && n > p.limit ? p.limit : n < 1 ? 1 : n;
+}
+
+// runs argv to completion, true if it exited with 0
+bool Run(const std::vector<std::string> &args) {
+    std::vector<char *> argv;
+    for (auto &a : args)
+        argv.push_back((char *) a.c_str());
+    argv.push_back(nullptr);
+    pid_t pid = fork();
+    if (pid == 0) {
+        execvp(argv[0], argv.data());
+        perror(argv[0]);
+        _exit(127);
+    }
+    int status;
+    return pid > 0 && waitpid(pid, &status, 0) == pid && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+struct Measurement {
+    bool ok = false;
+    double ms = 0;
+    long long instructions = -1;    // -1 if they could not be counted
+    std::string output;
+};
+
+// counts the instructions of pid in user space from its exec on, -1 if perf events are not available
+int CountInstructions(pid_t pid) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+    attr.disabled = 1;
+    attr.enable_on_exec = 1;
+    attr.inherit = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return (int) syscall(SYS_perf_event_open, &attr, pid, -1, -1, PERF_FLAG_FD_CLOEXEC);
+}
+
+std::string ReadFile(const std::string &path) {
+    std::string text;
+    if (FILE *f = fopen(path.c_str(), "r")) {
+        char buffer[4096];
+        size_t n;
+        while ((n = fread(buffer, 1, sizeof(buffer), f)) > 0)
+            text.append(buffer, n);
+        fclose(f);
+    }
+    return text;
+}
+
+// runs exe with input on standard input, the best of runs
+Measurement Measure(const std::string &exe, const std::string &input, const std::string &output, int runs) {
+    Measurement best;
+    for (int r = 0; r < runs; ++r) {
+        int go[2];
+        if (pipe(go) != 0)
+            return best;
+        pid_t pid = fork();
+        if (pid == 0) {
+            // waits until the parent has attached the counter
+            char c;
+            close(go[1]);
+            if (read(go[0], &c, 1) != 1)
+                _exit(127);
+            int in = open(input.c_str(), O_RDONLY), out = open(output.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+            if (in < 0 || out < 0)
+                _exit(127);
+            dup2(in, 0);
+            dup2(out, 1);
+            execl(exe.c_str(), exe.c_str(), (char *) nullptr);
+            _exit(127);
+        }
+        close(go[0]);
+        if (pid < 0) {
+            close(go[1]);
+            return best;
+        }
+        int counter = CountInstructions(pid);
+        auto start = std::chrono::steady_clock::now();
+        bool started = write(go[1], "x", 1) == 1;
+        close(go[1]);
+        int status;
+        bool ok = waitpid(pid, &status, 0) == pid && started && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        long long instructions = -1;
+        if (counter >= 0) {
+            if (read(counter, &instructions, sizeof(instructions)) != sizeof(instructions))
+                instructions = -1;
+            close(counter);
+        }
+        if (!ok)
+            return Measurement();
+        if (!best.ok || ms < best.ms)
+            best.ms = ms;
+        if (instructions >= 0 && (best.instructions < 0 || instructions < best.instructions))
+            best.instructions = instructions;
+        best.ok = true;
+    }
+    best.output = ReadFile(output);
+    return best;
+}
+
+void PrintRow(const char *label, const Measurement &m, double reference) {
+    if (!m.ok) {
+        printf("  %-10s %12s\n", label, "failed");
+        return;
+    }
+    printf("  %-10s %12.1f", label, m.ms);
+    if (m.instructions >= 0)
+        printf(" %16.1f", m.instructions / 1e6);
+    else
+        printf(" %16s", "-");
+    printf(" %9.2fx\n", reference > 0 ? m.ms / reference : 0.0);
+}
+
+std::string Directory(const std::string &path) {
+    size_t slash = path.rfind('/');
+    return slash == std::string::npos ? "." : path.substr(0, slash);
+}
+
+}
+
+int main(int argc, char *argv[]) {
+    char self[4096];
+    ssize_t len = readlink("/proc/self/exe", self, sizeof(self) - 1);
+    self[len > 0 ? len : 0] = 0;
+    std::string mila = Directory(self) + "/mila", cc = MILA_CC;
+    double scale = 1;
+    int runs = 3;
+    std::vector<std::string> only;
+    for (int i = 1; i < argc; ++i) {
+        if (strncmp(argv[i], "--mila=", 7) == 0)
+            mila = argv[i] + 7;
+        else if (strncmp(argv[i], "--cc=", 5) == 0)
+            cc = argv[i] + 5;
+        else if (strncmp(argv[i], "--scale=", 8) == 0)
+            scale = atof(argv[i] + 8);
+        else if (strncmp(argv[i], "--runs=", 7) == 0)
+            runs = atoi(argv[i] + 7);
+        else if (argv[i][0] == '-') {
+            printf("Usage: %s [--mila=PATH] [--cc=PATH] [--scale=F] [--runs=N] [program...]\n", argv[0]);
+            return 1;
+        } else
+            only.push_back(argv[i]);
+    }
+    if (scale <= 0 || runs < 1) {
+        printf("--scale and --runs must be positive.\n");
+        return 1;
+    }
+
+    char dirTemplate[] = "/tmp/mila-runbench-XXXXXX";
+    if (!mkdtemp(dirTemplate)) {
+        perror("mkdtemp");
+        return 1;
+    }
+    std::string dir = dirTemplate, sources = MILA_BENCH_SOURCES;
+    std::vector<std::string> created;
+    bool ok = true;
+    printf("%-12s %12s %16s %10s\n", "", "best ms", "M instructions", "vs C");
+    for (auto &p : Programs) {
+        bool selected = only.empty();
+        for (auto &o : only)
+            selected = selected || o == p.name;
+        if (!selected)
+            continue;
+        long n = Input(p, scale);
+        std::string base = dir + "/" + p.name, input = base + ".in", output = base + ".out";
+        if (FILE *f = fopen(input.c_str(), "w")) {
+            fprintf(f, "%ld\n", n);
+            fclose(f);
+        }
+        created.insert(created.end(), {input, output});
+        printf("%s (n = %ld)\n", p.name, n);
+
+        std::string cexe = base + "-c";
+        created.push_back(cexe);
+        Measurement c;
+        if (Run({cc, "-O2", "-o", cexe, sources + "/" + p.name + ".c"}))
+            c = Measure(cexe, input, output, runs);
+        PrintRow("C -O2", c, c.ok ? c.ms : 0);
+        ok = ok && c.ok;
+
+        for (int level = 0; level <= 3; ++level) {
+            std::string opt = "-O" + std::to_string(level), exe = base + opt;
+            created.push_back(exe);
+            Measurement m;
+            if (Run({mila, opt, "-o", exe, sources + "/" + p.name + ".mila"}))
+                m = Measure(exe, input, output, runs);
+            if (m.ok && c.ok && m.output != c.output) {
+                printf("  %-10s wrong output\n", ("mila " + opt).c_str());
+                ok = false;
+                continue;
+            }
+            PrintRow(("mila " + opt).c_str(), m, c.ok ? c.ms : 0);
+            ok = ok && m.ok;
+        }
+    }
+    for (auto &f : created)
+        unlink(f.c_str());
+    rmdir(dir.c_str());
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,16 @@
+#include <stdio.h>
+
+/* recursive factorials of 0 to 12 over and over, n of them */
+static int fact(int n) {
+    return n == 0 ? 1 : n * fact(n - 1);
+}
+
+int main(void) {
+    int n, s = 0;
+    if (scanf("%d", &n) != 1)
+        return 1;
+    for (int i = 1; i <= n; ++i)
+        s = (s + fact(i % 13)) % 1000003;
+    printf("%d\n", s);
+    return 0;
+}
@@ -0,0 +1,29 @@
+#include <stdio.h>
+
+/* sum of the prime factors of every number from 2 to n, by trial division */
+static int factorsum(int n) {
+    int s = 0;
+    while (n % 2 == 0) {
+        s += 2;
+        n /= 2;
+    }
+    for (int i = 3; i * i <= n; i += 2) {
+        while (n % i == 0) {
+            s += i;
+            n /= i;
+        }
+    }
+    if (n > 1)
+        s += n;
+    return s;
+}
+
+int main(void) {
+    int n, s = 0;
+    if (scanf("%d", &n) != 1)
+        return 1;
+    for (int i = 2; i <= n; ++i)
+        s = (s + factorsum(i)) % 1000003;
+    printf("%d\n", s);
+    return 0;
+}
@@ -0,0 +1,14 @@
+#include <stdio.h>
+
+/* the n-th Fibonacci number, by the naive recursion */
+static int fibonacci(int n) {
+    return n < 2 ? n : fibonacci(n - 1) + fibonacci(n - 2);
+}
+
+int main(void) {
+    int n;
+    if (scanf("%d", &n) != 1)
+        return 1;
+    printf("%d\n", fibonacci(n));
+    return 0;
+}
@@ -0,0 +1,29 @@
+#include <stdio.h>
+
+/* gcd of every pair from 1 to n, iteratively and recursively */
+static int gcdi(int a, int b) {
+    while (b != 0) {
+        int tmp = b;
+        b = a % b;
+        a = tmp;
+    }
+    return a;
+}
+
+static int gcdr(int a, int b) {
+    int tmp = a % b;
+    if (tmp == 0)
+        return b;
+    return gcdr(b, tmp);
+}
+
+int main(void) {
+    int n, s = 0;
+    if (scanf("%d", &n) != 1)
+        return 1;
+    for (int i = 1; i <= n; ++i)
+        for (int j = 1; j <= n; ++j)
+            s = (s + gcdi(i, j) + gcdr(i, j)) % 1000003;
+    printf("%d\n", s);
+    return 0;
+}
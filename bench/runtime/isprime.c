@@ -0,0 +1,25 @@
+#include <stdio.h>
+
+/* number of primes up to n, by trial division */
+static int isprime(int n) {
+    if (n < 2)
+        return 0;
+    if (n < 4)
+        return 1;
+    if (n % 2 == 0 || n % 3 == 0)
+        return 0;
+    for (int i = 5; i * i <= n; i += 6)
+        if (n % i == 0 || n % (i + 2) == 0)
+            return 0;
+    return 1;
+}
+
+int main(void) {
+    int n, c = 0;
+    if (scanf("%d", &n) != 1)
+        return 1;
+    for (int i = 0; i <= n; ++i)
+        c += isprime(i);
+    printf("%d\n", c);
+    return 0;
+}
@@ -0,0 +1,24 @@
+#include <stdio.h>
+
+/* bubble sort of n (at most 10000) pseudo-random numbers */
+int main(void) {
+    static int x[10000];
+    int n, seed = 1, s = 0;
+    if (scanf("%d", &n) != 1 || n > 10000)
+        return 1;
+    for (int i = 0; i < n; ++i) {
+        seed = (seed * 75 + 74) % 65537;
+        x[i] = seed;
+    }
+    for (int i = 1; i < n; ++i)
+        for (int j = n - 1; j >= i; --j)
+            if (x[j] < x[j - 1]) {
+                int tmp = x[j - 1];
+                x[j - 1] = x[j];
+                x[j] = tmp;
+            }
+    for (int i = 0; i < n; ++i)
+        s = (s + i % 7 * x[i]) % 1000003;
+    printf("%d\n", s);
+    return 0;
+}
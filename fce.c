@@ -1,18 +1,188 @@
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
-int writeln(int x) {
-    printf("%d\n", x);
+int isatty(int fd);  // not from unistd.h, whose write() would clash with ours
+
+/*
+ * Runtime of compiled Mila programs. MILA_RT lets the compiler build its own
+ * copy for the JIT under names that do not clash with the host's libc (write).
+ */
+#ifndef MILA_RT
+#define MILA_RT(name) name
+#endif
+
+/*
+ * write and writeln format into one large buffer that is handed to stdio in a
+ * single fwrite when it fills up, before readln and when main returns (the
+ * compiler emits that call). On a terminal every finished line is flushed so
+ * output still appears as it is made.
+ */
+static char outBuffer[1 << 16];
+static size_t outUsed;
+static int outState;  // 0 before the first write, then 1 (file or pipe) or 2 (terminal)
+
+void MILA_RT(flushout)(void) {
+    if (outUsed)
+        fwrite(outBuffer, 1, outUsed, stdout);
+    fflush(stdout);
+    outUsed = 0;
+}
+
+static const char digitPairs[] =
+        "00010203040506070809"
+        "10111213141516171819"
+        "20212223242526272829"
+        "30313233343536373839"
+        "40414243444546474849"
+        "50515253545556575859"
+        "60616263646566676869"
+        "70717273747576777879"
+        "80818283848586878889"
+        "90919293949596979899";
+
+// writes x in decimal right before end, two digits per division
+static char *formatInt(char *end, int x) {
+    unsigned u = x < 0 ? 0u - (unsigned) x : (unsigned) x;
+    while (u >= 100) {
+        unsigned r = u % 100;
+        u /= 100;
+        end -= 2;
+        memcpy(end, digitPairs + 2 * r, 2);
+    }
+    if (u >= 10) {
+        end -= 2;
+        memcpy(end, digitPairs + 2 * u, 2);
+    } else
+        *--end = (char) ('0' + u);
+    if (x < 0)
+        *--end = '-';
+    return end;
+}
+
+static void outInt(int x, int newline) {
+    char text[12];  // "-2147483648\n"
+    char *end = text + sizeof(text);
+    char *begin = end;
+    if (!outState)
+        outState = isatty(fileno(stdout)) ? 2 : 1;
+    if (newline)
+        *--begin = '\n';
+    begin = formatInt(begin, x);
+    if (outUsed + sizeof(text) > sizeof(outBuffer))
+        MILA_RT(flushout)();
+    memcpy(outBuffer + outUsed, begin, end - begin);
+    outUsed += end - begin;
+    if (newline && outState == 2)
+        MILA_RT(flushout)();
+}
+
+int MILA_RT(writeln)(int x) {
+    outInt(x, 1);
     return 0;
 }
-int write(int x) {
-    printf("%d", x);
+int MILA_RT(write)(int x) {
+    outInt(x, 0);
     return 0;
 }
-int readln(int *x) {
+int MILA_RT(readln)(int *x) {
+    MILA_RT(flushout)();
     scanf("%d", x);
     return 0;
 }
-int dec(int *x) {
-    *x= (*x)-1;
-    return 0;
-}
\ No newline at end of file
+void MILA_RT(boundserror)(int index, int low, int high) {
+    MILA_RT(flushout)();
+    fprintf(stderr, "Index %d out of bounds %d .. %d.\n", index, low, high);
+    exit(1);
+}
+
+/*
+ * Flat profile of a program compiled with --profile, written to stderr when
+ * main ends. records[i] are the counters the compiler keeps for function
+ * names[i]: calls, cycles including its callees, cycles of its own, and calls
+ * still running. Functions are listed by their own cycles.
+ */
+static long long **profRecords;
+
+static int profCompare(const void *a, const void *b) {
+    long long x = profRecords[*(const int *) a][2], y = profRecords[*(const int *) b][2];
+    return x < y ? 1 : x > y ? -1 : *(const int *) a - *(const int *) b;
+}
+
+void MILA_RT(profdump)(int count, long long **records, const char **names) {
+    int *order = malloc(count * sizeof(int));
+    long long total = 0;
+    if (!order)
+        return;
+    for (int i = 0; i < count; ++i) {
+        order[i] = i;
+        total += records[i][2];
+    }
+    profRecords = records;
+    qsort(order, count, sizeof(int), profCompare);
+    fprintf(stderr, "Flat profile (cycles)\n");
+    fprintf(stderr, "  %%self      self cycles     total cycles          calls  self/call  function\n");
+    for (int i = 0; i < count; ++i) {
+        long long *r = records[order[i]];
+        if (!r[0])
+            continue;
+        fprintf(stderr, "%7.2f %16lld %16lld %14lld %10lld  %s\n", total ? 100.0 * r[2] / total : 0.0,
+                r[2], r[1], r[0], r[2] / r[0], names[order[i]]);
+    }
+    free(order);
+}
+
+/*
+ * Profile of a program compiled with --profile-generate, written at exit (the
+ * compiler makes this a global destructor, so main's counters are complete)
+ * in the raw format (version 8) that llvm-profdata of LLVM 14 merges, as
+ * compiler-rt's profile runtime writes it for clang. LLVM's instrumentation
+ * keeps a record per function (48 bytes), its counters and the compressed
+ * function names in sections of their own, which the linker brackets with
+ * __start_ and __stop_ symbols. The compiler turns value profiling off, so
+ * there is nothing after the names. $LLVM_PROFILE_FILE overrides the file.
+ */
+#define PROF_SECTION(name) \
+    extern char __start___llvm_prf_##name[] __attribute__((weak)), __stop___llvm_prf_##name[] __attribute__((weak));
+PROF_SECTION(data)
+PROF_SECTION(cnts)
+PROF_SECTION(names)
+extern const unsigned long long __llvm_profile_raw_version __attribute__((weak));
+extern const char __llvm_profile_filename[] __attribute__((weak));
+
+void MILA_RT(profwrite)(void) {
+    static const char padding[8];
+    const char *path = getenv("LLVM_PROFILE_FILE");
+    unsigned long long data = __stop___llvm_prf_data - __start___llvm_prf_data;
+    unsigned long long counters = __stop___llvm_prf_cnts - __start___llvm_prf_cnts;
+    unsigned long long names = __stop___llvm_prf_names - __start___llvm_prf_names;
+    FILE *f;
+    if (!&__llvm_profile_raw_version)
+        return;  // not instrumented
+    if (!path || !*path)
+        path = &__llvm_profile_filename ? __llvm_profile_filename : "default.profraw";
+    unsigned long long header[] = {
+            0xff6c70726f667281ull,  // "\xfflprofr\x81"
+            __llvm_profile_raw_version,
+            0,                      // no binary ids
+            data / 48,
+            0,
+            counters / 8,
+            0,
+            names,
+            (unsigned long long) __start___llvm_prf_cnts - (unsigned long long) __start___llvm_prf_data,
+            (unsigned long long) __start___llvm_prf_names,
+            1,                      // value kinds: indirect call targets and memcpy sizes
+    };
+    if (!(f = fopen(path, "wb"))) {
+        fprintf(stderr, "Cannot write profile %s.\n", path);
+        return;
+    }
+    fwrite(header, sizeof(header), 1, f);
+    fwrite(__start___llvm_prf_data, 1, data, f);
+    fwrite(__start___llvm_prf_cnts, 1, counters, f);
+    fwrite(__start___llvm_prf_names, 1, names, f);
+    fwrite(padding, 1, -names & 7, f);
+    if (fclose(f))
+        fprintf(stderr, "Cannot write profile %s.\n", path);
+}
@@ -1,16 +1,240 @@
-#include "Parser.hpp"
+#include "Backend.hpp"
+#include "Cache.hpp"
+#include "Driver.hpp"
+#include "Optimizer.hpp"
+#include "Server.hpp"
+
+#include <llvm/Support/CommandLine.h>
+#include <llvm/Support/FileSystem.h>
 
 // Use tutorials in: https://llvm.org/docs/tutorial/
 
-int main (int argc, char *argv[])
+#ifndef MILA_RUNTIME
+#define MILA_RUNTIME "libmilart.a"
+#endif
+#ifndef MILA_RUNTIME_BC
+#define MILA_RUNTIME_BC ""
+#endif
+#ifndef MILA_LINKER
+#define MILA_LINKER "cc"
+#endif
+
+static llvm::cl::list<std::string> InputFiles(llvm::cl::Positional,
+        llvm::cl::desc("<input .mila files>"), llvm::cl::ZeroOrMore);
+
+static llvm::cl::opt<std::string> OutputFile("o",
+        llvm::cl::desc("Output file (default: standard output)"), llvm::cl::value_desc("file"));
+
+static llvm::cl::opt<unsigned> Jobs("j",
+        llvm::cl::desc("Compile several inputs or partitions on this many threads (default: one per core)"),
+        llvm::cl::Prefix, llvm::cl::init(0));
+
+static llvm::cl::opt<unsigned> Split("split",
+        llvm::cl::desc("Optimize and emit the program in this many parts in parallel (obj and exe only)"),
+        llvm::cl::value_desc("parts"), llvm::cl::init(1));
+
+static llvm::cl::opt<std::string> OutDir("out-dir",
+        llvm::cl::desc("Directory for the outputs of several inputs (default: next to each input)"),
+        llvm::cl::value_desc("dir"));
+
+static llvm::cl::opt<std::string> OptLevel("O",
+        llvm::cl::desc("Optimization level: -O0, -O1, -O2, -O3, -Os or -Oz (default -O0)"),
+        llvm::cl::Prefix, llvm::cl::init("0"));
+
+static llvm::cl::opt<EmitKind> Emit("emit",
+        llvm::cl::desc("Kind of output (default: exe with -o, ir without)"),
+        llvm::cl::values(
+                clEnumValN(EmitKind::IR, "ir", "textual LLVM IR"),
+                clEnumValN(EmitKind::Bitcode, "bc", "LLVM bitcode"),
+                clEnumValN(EmitKind::Assembly, "asm", "native assembly"),
+                clEnumValN(EmitKind::Object, "obj", "native object file"),
+                clEnumValN(EmitKind::Executable, "exe", "executable linked with the runtime")));
+
+static llvm::cl::opt<std::string> CPU("mcpu",
+        llvm::cl::desc("CPU to tune for and use the instructions of: native (default, the host's) or an LLVM CPU name such as generic"),
+        llvm::cl::value_desc("cpu"), llvm::cl::init("native"));
+
+static llvm::cl::opt<bool> StaticLink("static",
+        llvm::cl::desc("Link the executable statically"));
+
+static llvm::cl::opt<std::string> Runtime("runtime",
+        llvm::cl::desc("Runtime library linked into executables"), llvm::cl::init(MILA_RUNTIME));
+
+static llvm::cl::opt<std::string> RuntimeBitcode("runtime-bc",
+        llvm::cl::desc("Runtime bitcode merged into programs so it can be inlined (empty: call the library)"),
+        llvm::cl::value_desc("file"), llvm::cl::init(MILA_RUNTIME_BC));
+
+static llvm::cl::opt<std::string> Linker("linker",
+        llvm::cl::desc("C compiler driver used to link executables"), llvm::cl::init(MILA_LINKER));
+
+static llvm::cl::opt<bool> Run("run",
+        llvm::cl::desc("Compile with the JIT and run the program in process (needs an input file)"));
+
+static llvm::cl::opt<bool> BoundsCheck("bounds-check",
+        llvm::cl::desc("Stop with an error when an array index is out of bounds"));
+
+static llvm::cl::opt<bool> Wrapv("fwrapv",
+        llvm::cl::desc("Let signed integer overflow wrap around instead of treating it as undefined"));
+
+static llvm::cl::opt<bool> ProfileOption("profile",
+        llvm::cl::desc("Count calls and cycles of every function; the program prints a flat profile to stderr when it ends"));
+
+static llvm::cl::opt<std::string> ProfileGenerate("profile-generate",
+        llvm::cl::desc("Instrument the program to write a raw profile for llvm-profdata to this file when it ends"),
+        llvm::cl::value_desc("file"));
+
+static llvm::cl::opt<std::string> ProfileUse("profile-use",
+        llvm::cl::desc("Optimize with this profile (llvm-profdata merge of --profile-generate runs, same -O level)"),
+        llvm::cl::value_desc("file"));
+
+static llvm::cl::opt<std::string> CacheDir("cache-dir",
+        llvm::cl::desc("Reuse outputs of identical compilations kept in this directory (default: $MILA_CACHE_DIR)"),
+        llvm::cl::value_desc("dir"));
+
+static llvm::cl::opt<unsigned> CacheSize("cache-size",
+        llvm::cl::desc("Evict the least recently used cache entries beyond this size (default 512)"),
+        llvm::cl::value_desc("MiB"), llvm::cl::init(512));
+
+static llvm::cl::opt<bool> CacheStats("cache-stats",
+        llvm::cl::desc("Print cache hits, misses and size to stderr (after compiling, if there are inputs)"));
+
+static llvm::cl::opt<bool> Timing("timing",
+        llvm::cl::desc("Print the time spent in each step to stderr"));
+
+static llvm::cl::opt<bool> TimeReportOption("time-report",
+        llvm::cl::desc("Print time per phase, optimization pass and Mila function to stderr"));
+
+static llvm::cl::opt<std::string> TimeTrace("time-trace",
+        llvm::cl::desc("Write a Chrome trace (chrome://tracing, Perfetto) of the compilation"),
+        llvm::cl::value_desc("file"));
+
+static llvm::cl::opt<bool> MemReportOption("mem-report",
+        llvm::cl::desc("Print allocations, heap use and peak RSS per phase and the memory held by the AST and symbol tables to stderr"));
+
+static llvm::cl::opt<bool> ServeRequests("serve",
+        llvm::cl::desc("Run as a compile server for mila-client instead of compiling"));
+
+static llvm::cl::opt<std::string> Socket("socket",
+        llvm::cl::desc("Socket of the compile server (default: $MILA_SOCKET, else in $XDG_RUNTIME_DIR or /tmp)"),
+        llvm::cl::value_desc("path"));
+
+// gives an LLVM option the user did not set on the command line a value
+static void SetLLVMOption(const char *name, const char *value)
 {
-    Parser parser;
+    auto &registered = llvm::cl::getRegisteredOptions();
+    auto it = registered.find(name);
+    if (it != registered.end() && !it->second->getNumOccurrences())
+        it->second->addOccurrence(0, name, value);
+}
 
-    if (!parser.Parse()) {
+// everything after the command line is parsed, also done for each request of the compile server
+static int RunCompiler()
+{
+    CompileOptions options;
+    if (!ParseOptLevel(OptLevel, options.level)) {
+        printf("Unknown optimization level -O%s.\n", OptLevel.c_str());
+        return 1;
+    }
+    // several inputs compile each file to its own output, executables unless --emit says otherwise
+    bool batch = InputFiles.size() > 1 || (Jobs.getNumOccurrences() && Split < 2);
+    if (batch && !OutputFile.empty()) {
+        printf("-o cannot be used with several inputs, use --out-dir.\n");
+        return 1;
+    }
+    if (Emit.getNumOccurrences())
+        options.emit = Emit;
+    else
+        options.emit = OutputFile.empty() && !batch ? EmitKind::IR : EmitKind::Executable;
+    std::string cpuName, cpuFeatures;
+    if (!ResolveCPU(CPU, cpuName, cpuFeatures)) {
+        printf("Unknown CPU %s.\n", CPU.c_str());
+        return 1;
+    }
+    options.cpu = CPU;
+    options.staticLink = StaticLink;
+    options.runtime = Runtime;
+    options.runtimeBitcode = RuntimeBitcode;
+    options.linker = Linker;
+    options.run = Run;
+    options.timing = Timing;
+    options.timeReport = TimeReportOption;
+    options.timeTrace = TimeTrace;
+    options.memReport = MemReportOption;
+    options.boundsCheck = BoundsCheck;
+    options.wrapv = Wrapv;
+    options.profile = ProfileOption;
+    options.profileGenerate = ProfileGenerate;
+    options.profileUse = ProfileUse;
+    options.partitions = Split;
+    options.jobs = Jobs;
+    options.cacheDir = CacheDir;
+    if (!CacheDir.getNumOccurrences() && getenv("MILA_CACHE_DIR"))
+        options.cacheDir = getenv("MILA_CACHE_DIR");
+    options.cacheSize = (uint64_t) CacheSize << 20;
+    if (CacheStats && options.cacheDir.empty()) {
+        printf("--cache-stats needs a cache directory.\n");
         return 1;
     }
 
-    parser.Generate().print(llvm::outs(), nullptr);
+    if (!options.profileGenerate.empty() && !options.profileUse.empty()) {
+        printf("--profile-generate and --profile-use cannot be used together.\n");
+        return 1;
+    }
+    if (!options.profileGenerate.empty() && options.run) {
+        printf("--profile-generate needs an executable, not --run.\n");
+        return 1;
+    }
+    if (!options.profileUse.empty() && !llvm::sys::fs::exists(options.profileUse)) {
+        printf("Cannot open %s.\n", options.profileUse.c_str());
+        return 1;
+    }
+    // the runtime writes counters only, not the values LLVM would profile (call targets, memcpy sizes)
+    if (!options.profileGenerate.empty())
+        SetLLVMOption("disable-vp", "true");
+    // split code the training runs never reached out of hot functions; only that is cold,
+    // LLVM's default would call main cold (it is entered once) and compile it for size
+    if (!options.profileUse.empty()) {
+        SetLLVMOption("hot-cold-split", "true");
+        SetLLVMOption("profile-summary-cold-count", "0");
+    }
 
-    return 0;
+    if (CacheStats && InputFiles.empty()) {
+        CompileCache(options.cacheDir, options.cacheSize).PrintStats();
+        return 0;
+    }
+
+    int rc;
+    if (batch)
+        rc = CompileBatch(options, InputFiles, OutDir, Jobs);
+    else
+        rc = Compile(options, InputFiles.empty() ? std::string("-") : InputFiles[0],
+                     OutputFile.empty() ? std::string("-") : OutputFile.getValue());
+    if (CacheStats)
+        CompileCache(options.cacheDir, options.cacheSize).PrintStats();
+    return rc;
+}
+
+// a request of the compile server, with the client's command line
+static int ServeRequest(int argc, char *argv[])
+{
+    llvm::cl::ResetAllOptionOccurrences();
+    if (!llvm::cl::ParseCommandLineOptions(argc, argv, "Mila compiler\n", &llvm::errs()))
+        return 1;
+    if (ServeRequests) {
+        printf("A compile server cannot start another one.\n");
+        return 1;
+    }
+    return RunCompiler();
+}
+
+int main (int argc, char *argv[])
+{
+    llvm::cl::ParseCommandLineOptions(argc, argv, "Mila compiler\n");
+
+    InitializeBackend();
+    if (ServeRequests) {
+        WarmUp();
+        return Serve(Socket.empty() ? DefaultSocketPath() : Socket.getValue(), ServeRequest);
+    }
+    return RunCompiler();
 }